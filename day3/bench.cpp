@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "wire.hpp"
+#include "intersect.hpp"
+#include "wireset.hpp"
+#include "parallel.hpp"
+#include "segments.hpp"
+#include "raster.hpp"
+#include "incremental.hpp"
+#include "generator.hpp"
+
+/* Scaling benchmarks for the crossing engines, run with `make bench` */
+
+// brute force is quadratic, skip it past this many segments a wire
+const long BRUTE_FORCE_MAX_SEGMENTS = 20000;
+// rasterizing allocates a table per point, skip it past this many points
+const long RASTER_MAX_BENCH_POINTS = 1L << 24;
+// small boards are repeated until each phase has taken about this long
+const double MIN_SECONDS = 0.05;
+
+/**
+ * Average seconds per call of a function, repeating it until at least
+ * MIN_SECONDS have passed
+ */
+double time_call(std::function<void(void)> call) {
+    typedef std::chrono::steady_clock Clock;
+
+    long iterations = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do {
+        call();
+        iterations++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while(elapsed < MIN_SECONDS);
+
+    return elapsed / iterations;
+}
+
+void print_row(const char* engine, long segments, double parse, double index, double query, long crossings) {
+    char index_text[32] = "-";
+    if(index >= 0) snprintf(index_text, sizeof(index_text), "%.3f", index * 1000);
+
+    printf("%-12s %10ld %12.3f %12s %12.3f %12ld\n", engine, segments, parse * 1000, index_text,
+        query * 1000, crossings);
+    fflush(stdout);
+}
+
+/**
+ * Time every engine on one generated board, engines which build their index
+ * as part of the query report no separate index time
+ */
+void run_board(const GeneratorOptions& options, int thread_count) {
+    std::string text = generate_wires(options);
+
+    std::vector<Wire> wires;
+    double parse = time_call([&]() { wires = parse_wires(text.data(), text.size()); });
+
+    const Wire& first = wires[0];
+    const Wire& second = wires[1];
+    long segments = options.segments;
+    long crossings = 0;
+
+    if(segments <= BRUTE_FORCE_MAX_SEGMENTS) {
+        double query = time_call([&]() { crossings = find_crossings_brute_force(first, second).size(); });
+        print_row("brute", segments, parse, -1, query, crossings);
+    }
+
+    double query = time_call([&]() { crossings = find_crossings_sweep(first, second).size(); });
+    print_row("sweep", segments, parse, -1, query, crossings);
+
+    SegmentStore* stores[2] = {nullptr, nullptr};
+    double index = time_call([&]() {
+        delete stores[0];
+        delete stores[1];
+        stores[0] = new SegmentStore(first);
+        stores[1] = new SegmentStore(second);
+    });
+    query = time_call([&]() { crossings = find_crossings_batched(*stores[0], *stores[1]).size(); });
+    print_row("batched", segments, parse, index, query, crossings);
+    delete stores[0];
+    delete stores[1];
+
+    WireSet* wire_set = nullptr;
+    index = time_call([&]() {
+        delete wire_set;
+        wire_set = new WireSet(wires);
+    });
+    query = time_call([&]() { crossings = wire_set->summarize().crossings; });
+    print_row("grid", segments, parse, index, query, crossings);
+    delete wire_set;
+
+    ThreadPool pool(thread_count);
+    query = time_call([&]() { crossings = find_crossings_parallel(wires, pool).crossings; });
+    print_row("parallel", segments, parse, -1, query, crossings);
+
+    if(first.steps.back() <= RASTER_MAX_BENCH_POINTS) {
+        query = time_call([&]() { crossings = find_crossings_raster(first, second).crossings; });
+        print_row("raster", segments, parse, -1, query, crossings);
+    }
+
+    // both wires grown a move at a time, alternating as main does
+    query = time_call([&]() {
+        IncrementalCrossings incremental;
+        long longest = std::max(first.length, second.length);
+        for(long i = 1; i < longest; i++) {
+            if(i < first.length) incremental.append(0, first.points[i]);
+            if(i < second.length) incremental.append(1, second.points[i]);
+        }
+        crossings = incremental.summary.crossings;
+    });
+    print_row("incremental", segments, parse, -1, query, crossings);
+}
+
+int main(int argc, char** argv) {
+
+    GeneratorOptions options;
+    long max_segments = 1000000;
+    int thread_count = 0;
+    bool density_given = false;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--adversarial") == 0) options.mode = GENERATE_ADVERSARIAL;
+        else if(i + 1 < argc && strcmp(argv[i], "--max") == 0) max_segments = atof(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--density") == 0) {
+            options.density = atof(argv[++i]);
+            density_given = true;
+        }
+        else if(i + 1 < argc && strcmp(argv[i], "--max-move") == 0) options.max_move = atoi(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--threads") == 0) thread_count = atoi(argv[++i]);
+    }
+
+    // the adversarial board has about density * n^2 / 4 crossings
+    if(options.mode == GENERATE_ADVERSARIAL && !density_given) options.density = 0.01;
+
+    printf("%-12s %10s %12s %12s %12s %12s\n", "ENGINE", "SEGMENTS", "PARSE MS", "INDEX MS", "QUERY MS", "CROSSINGS");
+
+    for(long segments = 1000; segments <= max_segments; segments *= 10) {
+        options.segments = segments;
+        run_board(options, thread_count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "generator.hpp"
+
+static void append_move(std::string& out, char direction, long distance) {
+    if(out.size() > 0 && out.back() != '\n') out.push_back(',');
+    out.push_back(direction);
+    out += std::to_string(distance);
+}
+
+/**
+ * Alternate between horizontal and vertical moves, turning around instead of
+ * leaving the box. The first axis and the starting heading on each axis are
+ * random per wire, so wires do not all leave the origin along each other. A walk of n moves averaging length m bouncing around a
+ * box of side 0.75 * m * sqrt(n / density) crosses another such walk about
+ * density times per segment (measured from 10^3 to 10^5 segments)
+ */
+static void generate_random_wire(std::string& out, const GeneratorOptions& options, std::mt19937_64& random) {
+    double average_move = (options.max_move + 1) / 2.0;
+    long half_side = std::max(1L, (long)(0.375 * average_move * std::sqrt((double)options.segments / std::max(options.density, 1e-9))));
+    half_side = std::min(half_side, (long)1 << 29);
+
+    std::uniform_int_distribution<int> move(1, std::max(options.max_move, 1));
+    std::bernoulli_distribution turn(0.1);
+    std::bernoulli_distribution coin(0.5);
+    long x = 0, y = 0;
+    // axis 0 is x
+    int first_axis = coin(random);
+    bool heading[2] = {coin(random), coin(random)};
+
+    for(long i = 0; i < options.segments; i++) {
+        long distance = move(random);
+        int axis = (i + first_axis) % 2;
+
+        // mostly keep heading the same way on each axis so the walk bounces
+        // around the whole box instead of staying near where it started
+        bool& positive = heading[axis];
+        if(turn(random)) positive = !positive;
+
+        long& coordinate = (axis == 0) ? x : y;
+        if(positive && coordinate + distance > half_side) positive = false;
+        else if(!positive && coordinate - distance < -half_side) positive = true;
+        coordinate += positive ? distance : -distance;
+
+        if(axis == 0) append_move(out, positive ? 'R' : 'L', distance);
+        else append_move(out, positive ? 'U' : 'D', distance);
+    }
+}
+
+/**
+ * Even wires sweep up and down along even x, odd wires sweep left and right
+ * along odd y across the whole width of the even wires, starting from
+ * (-1, 1) so no segments lie on top of each other
+ */
+static void generate_adversarial_wire(std::string& out, const GeneratorOptions& options, int wire) {
+    long teeth = std::max(1L, options.segments / 2);
+    long span = 2 * teeth + 2;
+    // verticals reach density of the horizontals, which sit 2 apart
+    long height = std::max(1L, (long)(options.density * span));
+
+    if(wire % 2 == 0) {
+        for(long i = 0; i < teeth; i++) {
+            append_move(out, (i % 2 == 0) ? 'U' : 'D', height);
+            append_move(out, 'R', 2);
+        }
+    } else {
+        append_move(out, 'L', 1);
+        append_move(out, 'U', 1);
+        for(long i = 1; i < teeth; i++) {
+            append_move(out, (i % 2 == 1) ? 'R' : 'L', span);
+            append_move(out, 'U', 2);
+        }
+    }
+}
+
+std::string generate_wires(const GeneratorOptions& options) {
+    std::mt19937_64 random(options.seed);
+    std::string out;
+    out.reserve(options.wires * options.segments * 5);
+
+    for(int wire = 0; wire < options.wires; wire++) {
+        if(options.mode == GENERATE_ADVERSARIAL) generate_adversarial_wire(out, options, wire);
+        else generate_random_wire(out, options, random);
+        out.push_back('\n');
+    }
+
+    return out;
+}
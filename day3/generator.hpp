@@ -0,0 +1,33 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <string>
+
+enum GeneratorMode {
+    // random walks turning at every move, kept inside a box sized so there
+    // are about density crossings per segment
+    GENERATE_RANDOM = 0,
+    // one wire a comb of verticals, the other a comb of horizontals as wide
+    // as the board, every vertical crosses about density of the horizontals
+    GENERATE_ADVERSARIAL = 1
+};
+
+class GeneratorOptions {
+public:
+    int mode;
+    // segments per wire
+    long segments;
+    double density;
+    int wires;
+    // longest single move of a random walk
+    int max_move;
+    unsigned long seed;
+
+    GeneratorOptions() : mode(GENERATE_RANDOM), segments(1000), density(1.0), wires(2),
+        max_move(100), seed(1) {}
+};
+
+// wire descriptions in the puzzle input format, one wire per line
+std::string generate_wires(const GeneratorOptions& options);
+
+#endif // !GENERATOR_HPP
@@ -0,0 +1,179 @@
+#include "incremental.hpp"
+
+template<class T>
+int SpanIndex<T>::add_node(void) {
+    nodes.push_back(Node{{-1, -1}, -1});
+    return nodes.size() - 1;
+}
+
+/**
+ * Index a segment spanning [low, high] with the given fixed coordinate
+ */
+template<class T>
+void SpanIndex<T>::insert(T low, T high, T fixed, int index) {
+    unsigned long low_key = get_key(low);
+    unsigned long high_key = get_key(high);
+
+    if(root < 0) {
+        root = add_node();
+        root_start = low_key;
+        root_level = 0;
+    }
+
+    // the old root becomes one half of a root twice its size
+    while(low_key < root_start || high_key > get_end(root_start, root_level)) {
+        int parent = add_node();
+        nodes[parent].children[(root_start >> root_level) & 1] = root;
+        root = parent;
+        root_level++;
+        root_start &= ~get_end(0, root_level);
+    }
+
+    insert(root, root_start, root_level, low_key, high_key, fixed, index);
+}
+
+/**
+ * Store the segment in the node if its span covers the node's block, else
+ * pass it on to the halves it overlaps. A block of a single key is always
+ * covered, so level is above 0 when splitting
+ */
+template<class T>
+void SpanIndex<T>::insert(int node, unsigned long start, int level, unsigned long low, unsigned long high,
+    T fixed, int index) {
+
+    if(low <= start && high >= get_end(start, level)) {
+        if(nodes[node].list < 0) {
+            nodes[node].list = lists.size();
+            lists.emplace_back();
+        }
+        lists[nodes[node].list].insert({fixed, index});
+        return;
+    }
+
+    for(int half = 0; half < 2; half++) {
+        unsigned long half_start = start + half * (1UL << (level - 1));
+        if(high < half_start || low > get_end(half_start, level - 1)) continue;
+
+        int child = nodes[node].children[half];
+        if(child < 0) {
+            child = add_node();
+            nodes[node].children[half] = child;
+        }
+        insert(child, half_start, level - 1, low, high, fixed, index);
+    }
+}
+
+/**
+ * Walk from the root down to the block of the single point, every segment
+ * stored along the way covers the point
+ */
+template<class T>
+template<class Visitor>
+void SpanIndex<T>::visit(T point, T fixed_min, T fixed_max, Visitor visit) const {
+    unsigned long key = get_key(point);
+    if(root < 0 || key < root_start || key > get_end(root_start, root_level)) return;
+
+    int node = root;
+    int level = root_level;
+    while(node >= 0) {
+        if(nodes[node].list >= 0) {
+            const std::multimap<T, int>& list = lists[nodes[node].list];
+            auto end = list.upper_bound(fixed_max);
+            for(auto it = list.lower_bound(fixed_min); it != end; it++) visit(it->first, it->second);
+        }
+        if(level == 0) break;
+
+        level--;
+        node = nodes[node].children[(key >> level) & 1];
+    }
+}
+
+template<class T>
+BasicIncrementalCrossings<T>::BasicIncrementalCrossings() {
+    wires.push_back(BasicWire<T>(std::vector<BasicPoint<T>>(1, BasicPoint<T>(0, 0))));
+    wires.push_back(BasicWire<T>(std::vector<BasicPoint<T>>(1, BasicPoint<T>(0, 0))));
+}
+
+/**
+ * Extend a wire to a new point in line with its current end, crossings with
+ * the other wire are found from that wire's index and folded into the
+ * summary, the segment is then indexed for the other wire's later appends
+ *
+ * @param wire wire to extend, 0 or 1
+ * @param point new end of the wire
+ * @returns updated summary
+ */
+template<class T>
+const BasicCrossingSummary<T>& BasicIncrementalCrossings<T>::append(int wire, const BasicPoint<T>& point) {
+    BasicWire<T>& self = wires[wire];
+    const BasicWire<T>& other = wires[1 - wire];
+
+    BasicPoint<T> origin = self.points.back();
+    if(origin.x != point.x && origin.y != point.y) {
+        std::cout << "Wire segments must be horizontal or vertical" << std::endl;
+        exit(-1);
+    }
+
+    self.append(point);
+    int index = self.length - 2;
+
+    // zero length segments count as vertical, as with is_line_vertical
+    bool vertical = origin.x == point.x;
+
+    // a vertical crosses horizontals with y in its range that span its x
+    const SpanIndex<T>& candidates = vertical ? horizontals[1 - wire] : verticals[1 - wire];
+    T fixed = vertical ? point.x : point.y;
+    T range_min = vertical ? std::min(origin.y, point.y) : std::min(origin.x, point.x);
+    T range_max = vertical ? std::max(origin.y, point.y) : std::max(origin.x, point.x);
+
+    candidates.visit(fixed, range_min, range_max, [&](T other_fixed, int other_index) {
+        BasicPoint<T> crossing = vertical ? BasicPoint<T>(point.x, other_fixed) : BasicPoint<T>(other_fixed, point.y);
+        long steps = self.get_steps_to(index, crossing) + other.get_steps_to(other_index, crossing);
+
+        if(wire == 0) summary.add(BasicWireCrossing<T>(crossing, 0, index, 1, other_index, steps));
+        else summary.add(BasicWireCrossing<T>(crossing, 0, other_index, 1, index, steps));
+    });
+
+    if(vertical) verticals[wire].insert(range_min, range_max, fixed, index);
+    else horizontals[wire].insert(range_min, range_max, fixed, index);
+
+    return summary;
+}
+
+/**
+ * Extend a wire by a single move such as R75
+ */
+template<class T>
+const BasicCrossingSummary<T>& BasicIncrementalCrossings<T>::append(int wire, char direction, T distance) {
+    BasicPoint<T> point(wires[wire].points.back());
+    bool overflow = false;
+    switch(direction) {
+        case 'U':
+            overflow = __builtin_add_overflow(point.y, distance, &point.y);
+            break;
+        case 'D':
+            overflow = __builtin_sub_overflow(point.y, distance, &point.y);
+            break;
+        case 'L':
+            overflow = __builtin_sub_overflow(point.x, distance, &point.x);
+            break;
+        case 'R':
+            overflow = __builtin_add_overflow(point.x, distance, &point.x);
+            break;
+        default:
+            std::cout << "Encountered unexpected direction '" << direction << "'" << std::endl;
+            exit(-1);
+    }
+
+    if(overflow) {
+        std::cout << "Wire coordinates do not fit in " << 8 * sizeof(T) << " bits" << std::endl;
+        exit(-1);
+    }
+
+    return append(wire, point);
+}
+
+template class SpanIndex<int>;
+template class SpanIndex<long>;
+template class BasicIncrementalCrossings<int>;
+template class BasicIncrementalCrossings<long>;
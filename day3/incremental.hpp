@@ -0,0 +1,87 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <map>
+#include <vector>
+
+#include "wire.hpp"
+#include "wireset.hpp"
+
+/**
+ * Segments of one orientation, found by a point their span covers and a
+ * range their fixed coordinate lies in. A segment tree over the span
+ * coordinate holds each segment in the few nodes whose ranges exactly cover
+ * its span, and every node keeps its segments ordered by fixed coordinate.
+ * A point lies in one node per level, so a query costs O(log^2 n + k) no
+ * matter how many segments share the fixed range or the point.
+ *
+ * Node ranges are aligned power of two blocks of coordinates, the root is
+ * the smallest block holding every span so far and grows upwards as spans
+ * reach outside it, so the tree is only as deep as the board is wide
+ */
+template<class T>
+class SpanIndex {
+public:
+    SpanIndex() : root(-1), root_start(0), root_level(0) {}
+
+    void insert(T low, T high, T fixed, int index);
+
+    // call visit(fixed, index) for every segment whose span holds point and
+    // whose fixed coordinate is in [fixed_min, fixed_max]
+    template<class Visitor>
+    void visit(T point, T fixed_min, T fixed_max, Visitor visit) const;
+
+private:
+    class Node {
+    public:
+        int children[2];
+        // index into lists, -1 until a segment is stored here
+        int list;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<std::multimap<T, int>> lists;
+    int root;
+    // root covers [root_start, root_start + 2^root_level) of the keys
+    unsigned long root_start;
+    int root_level;
+
+    // coordinates as unsigned keys in the same order
+    static unsigned long get_key(T value) { return (unsigned long)(long)value ^ (1UL << 63); }
+    // last key of a block of 2^level keys starting at start
+    static unsigned long get_end(unsigned long start, int level) {
+        return start | ((level >= 64) ? ~0UL : (1UL << level) - 1);
+    }
+
+    int add_node(void);
+    void insert(int node, unsigned long start, int level, unsigned long low, unsigned long high, T fixed, int index);
+};
+
+/**
+ * Two wires which grow a segment at a time while keeping the closest and
+ * shortest crossings up to date, each new segment is only tested against
+ * the other wire's perpendicular segments whose span covers its fixed
+ * coordinate and whose fixed coordinate lies in its range
+ */
+template<class T>
+class BasicIncrementalCrossings {
+public:
+    std::vector<BasicWire<T>> wires;
+    BasicCrossingSummary<T> summary;
+
+    BasicIncrementalCrossings();
+
+    const BasicCrossingSummary<T>& append(int wire, const BasicPoint<T>& point);
+    const BasicCrossingSummary<T>& append(int wire, char direction, T distance);
+
+private:
+    // segment indices of each wire, horizontals span x at a fixed y and
+    // verticals span y at a fixed x
+    SpanIndex<T> horizontals[2];
+    SpanIndex<T> verticals[2];
+};
+
+typedef BasicIncrementalCrossings<int> IncrementalCrossings;
+typedef BasicIncrementalCrossings<long> IncrementalCrossings64;
+
+#endif // !INCREMENTAL_HPP
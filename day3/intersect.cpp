@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <map>
+
+#include "intersect.hpp"
+
+template<class T>
+long get_combined_steps(const BasicWire<T>& first, const BasicWire<T>& second, const BasicCrossing<T>& crossing) {
+    return first.get_steps_to(crossing.first_index, crossing.point) +
+        second.get_steps_to(crossing.second_index, crossing.point);
+}
+
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_brute_force(const BasicWire<T>& first, const BasicWire<T>& second) {
+    std::vector<BasicCrossing<T>> crossings;
+
+    for(int i = 0; i < first.length-1; i++) {
+        BasicLine<T> a = first.get_line(i);
+        for(int j = 0; j < second.length-1; j++) {
+            BasicLine<T> b = second.get_line(j);
+
+            if(do_lines_intersect(a, b)) {
+                crossings.push_back(BasicCrossing<T>(get_intersection(a, b), i, j));
+            }
+        }
+    }
+
+    return crossings;
+}
+
+// event kinds, ordered so that at equal y verticals are inserted before
+// horizontals query them and removed after, segment ends are inclusive
+enum {
+    EVENT_INSERT,
+    EVENT_QUERY,
+    EVENT_REMOVE
+};
+
+template<class T>
+class SweepEvent {
+public:
+    T y;
+    int kind;
+    int wire;
+    int index;
+    // x of a vertical segment, or the x range of a horizontal one
+    T x_min, x_max;
+
+    SweepEvent(T y, int kind, int wire, int index, T x_min, T x_max) :
+        y(y), kind(kind), wire(wire), index(index), x_min(x_min), x_max(x_max) {}
+
+    inline bool operator<(const SweepEvent& event) const {
+        return y < event.y || (y == event.y && kind < event.kind);
+    }
+};
+
+template<class T>
+static void add_sweep_events(const BasicWire<T>& wire, int wire_number, std::vector<SweepEvent<T>>& events) {
+    for(int i = 0; i < wire.length-1; i++) {
+        const BasicPoint<T>& origin = wire.points[i];
+        const BasicPoint<T>& dest = wire.points[i+1];
+
+        if(origin.x == dest.x) {
+            T x = origin.x;
+            events.push_back(SweepEvent<T>(std::min(origin.y, dest.y), EVENT_INSERT, wire_number, i, x, x));
+            events.push_back(SweepEvent<T>(std::max(origin.y, dest.y), EVENT_REMOVE, wire_number, i, x, x));
+        } else {
+            events.push_back(SweepEvent<T>(origin.y, EVENT_QUERY, wire_number, i,
+                std::min(origin.x, dest.x), std::max(origin.x, dest.x)));
+        }
+    }
+}
+
+/**
+ * Only perpendicular crossings are reported, parallel segments lying on top
+ * of each other are not (brute force reports those at a single endpoint)
+ */
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_sweep(const BasicWire<T>& first, const BasicWire<T>& second) {
+    std::vector<SweepEvent<T>> events;
+    events.reserve(2 * (first.length + second.length));
+    add_sweep_events(first, 0, events);
+    add_sweep_events(second, 1, events);
+
+    std::sort(events.begin(), events.end());
+
+    // vertical segments currently crossing the sweep line, by x, per wire
+    typedef std::multimap<T, int> ActiveSet;
+    ActiveSet active[2];
+    std::vector<typename ActiveSet::iterator> handles[2] = {
+        std::vector<typename ActiveSet::iterator>(std::max(first.length, 1L)),
+        std::vector<typename ActiveSet::iterator>(std::max(second.length, 1L))
+    };
+
+    std::vector<BasicCrossing<T>> crossings;
+
+    for(const SweepEvent<T>& event : events) {
+        switch(event.kind) {
+            case EVENT_INSERT:
+                handles[event.wire][event.index] = active[event.wire].insert({event.x_min, event.index});
+                break;
+            case EVENT_REMOVE:
+                active[event.wire].erase(handles[event.wire][event.index]);
+                break;
+            case EVENT_QUERY: {
+                // horizontals only cross the other wire's verticals
+                const ActiveSet& other = active[1 - event.wire];
+                auto end = other.upper_bound(event.x_max);
+                for(auto it = other.lower_bound(event.x_min); it != end; it++) {
+                    BasicPoint<T> point(it->first, event.y);
+                    if(event.wire == 0) crossings.push_back(BasicCrossing<T>(point, event.index, it->second));
+                    else crossings.push_back(BasicCrossing<T>(point, it->second, event.index));
+                }
+                break;
+            }
+        }
+    }
+
+    // report in the same order as brute force
+    std::sort(crossings.begin(), crossings.end(), [](const BasicCrossing<T>& a, const BasicCrossing<T>& b) {
+        return a.first_index < b.first_index ||
+            (a.first_index == b.first_index && a.second_index < b.second_index);
+    });
+
+    return crossings;
+}
+
+template long get_combined_steps<int>(const Wire& first, const Wire& second, const Crossing& crossing);
+template long get_combined_steps<long>(const Wire64& first, const Wire64& second, const Crossing64& crossing);
+template std::vector<Crossing> find_crossings_brute_force<int>(const Wire& first, const Wire& second);
+template std::vector<Crossing64> find_crossings_brute_force<long>(const Wire64& first, const Wire64& second);
+template std::vector<Crossing> find_crossings_sweep<int>(const Wire& first, const Wire& second);
+template std::vector<Crossing64> find_crossings_sweep<long>(const Wire64& first, const Wire64& second);
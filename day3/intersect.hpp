@@ -0,0 +1,39 @@
+#ifndef INTERSECT_HPP
+#define INTERSECT_HPP
+
+#include <vector>
+
+#include "wire.hpp"
+
+/**
+ * A point where a segment of the first wire crosses a segment of the second,
+ * indices are segment (line) indices into each wire
+ */
+template<class T>
+class BasicCrossing {
+public:
+    BasicPoint<T> point;
+    int first_index;
+    int second_index;
+
+    BasicCrossing(const BasicPoint<T>& point, int first_index, int second_index) :
+        point(point), first_index(first_index), second_index(second_index) {}
+};
+
+typedef BasicCrossing<int> Crossing;
+typedef BasicCrossing<long> Crossing64;
+
+// combined steps both wires take to reach the crossing
+template<class T>
+long get_combined_steps(const BasicWire<T>& first, const BasicWire<T>& second, const BasicCrossing<T>& crossing);
+
+// reference mode, tests every segment of one wire against every segment of the other
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_brute_force(const BasicWire<T>& first, const BasicWire<T>& second);
+
+// sweeps a horizontal line upwards over both wires, O((n+m) log n + k),
+// built for both int and 64 bit coordinates
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_sweep(const BasicWire<T>& first, const BasicWire<T>& second);
+
+#endif // !INTERSECT_HPP
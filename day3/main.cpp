@@ -1,287 +1,175 @@
-#include <iostream>
-#include <string>
-#include <vector>
-#include <fstream>
-#include <sstream>
-#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "wire.hpp"
+#include "intersect.hpp"
+#include "wireset.hpp"
+#include "parallel.hpp"
+#include "segments.hpp"
+#include "raster.hpp"
+#include "incremental.hpp"
 
-class Point {
-public:
-    int x, y;
-    Point(int x, int y) : x(x), y(y) {}
-    Point(const Point& xy) : x(xy.x), y(xy.y) {}
-    void operator=(const Point& xy) {
-        x = xy.x;
-        y = xy.y;
-    }
-    inline bool operator==(const Point& point) const {
-        return x == point.x && y == point.y;
-    }
-
-    std::string to_string(void) const {
-        return "(" + std::to_string(x) + ", " + std::to_string(y) + ")";
-    }
-};
-
-class Line {
-public:
-    const Point& origin;
-    const Point& dest;
-    Line(const Point& origin, const Point& dest) : origin(origin), dest(dest) {}
-    Line(const Line& line) : origin(line.origin), dest(line.dest) {}
-
-    std::string to_string(void) const {
-        return origin.to_string() + " --- " + dest.to_string(); 
-    }
-
-    int length(void) {
-        int len = ( std::max( std::abs(origin.x - dest.x), std::abs(origin.y - dest.y) ) );
+#define INPUT_FILE "./test_input"
 
-        std::cout << origin.to_string() << " --> " << dest.to_string() << ", LEN: " << len << std::endl;
+/**
+ * Print every crossing between two wires, then the closest and the shortest
+ */
+template<class T>
+void report_crossings(const BasicWire<T>& first, const BasicWire<T>& second,
+    const std::vector<BasicCrossing<T>>& crossings) {
 
-        return len;
-    }
-};
+    long lowest_distance = std::numeric_limits<long>::max();
+    BasicPoint<T> lowest_dist_pos(0,0);
 
-class Wire {
-public:
-    std::vector<Point> points;
-    int length;
+    long lowest_length = std::numeric_limits<long>::max();
+    BasicPoint<T> lowest_len_pos(0, 0);
 
-    Wire(std::vector<Point> points) {
-        Wire::points = points;
-        Wire::length = points.size();
-    }
+    for(const BasicCrossing<T>& crossing : crossings) {
+        BasicPoint<T> intersection = crossing.point;
+        long distance = get_manhatten_distance(intersection);
+        long total_len = get_combined_steps(first, second, crossing);
 
-    Line get_line(int index) const {
-        if(index == points.size()) index-=1;
+        std::cout << "FOUND INTERSECT AT " << intersection.to_string() 
+            << ", WITH DISTANCE " << distance 
+            << ", AND LENGTH " << total_len << std::endl;
 
-        return Line(points[index], points[index+1]);
-    }
+        if(distance == 0) continue;
 
-    int get_wire_length(int index, int offset) {
-        int total_len = 0;
-        for(int i = 0; i < index; i++) {
-            total_len += get_line(i).length();
+        if(distance < lowest_distance) {
+            lowest_dist_pos = intersection;
+            lowest_distance = distance;
         }
-
-        std::cout << "LINE INDEX " <<  index << " WITH LEN " << total_len << " WITH OFFSET " << offset << std::endl;
-
-        return total_len + offset;
-    }
-
-    bool does_wire_intersect(int x, int y) const {
-        for(int i = 0; i < points.size() - 1; i++) {
-            const Point* a = &points[i];
-            const Point* b = &points[i+1];
-
-            // this is an x crossing
-            if(a->x == b->x) {
-                if(x <= std::max(a->x, b->x) && x >= std::min(a->x, b->x)) {
-                    return true;
-                }
-            }
-            // this is a y crossing
-            if(a->y == b->y) {
-                if(y <= std::max(a->y, b->y) && y >= std::min(a->y, b->y)) {
-                    return true;
-                }
-            }
+        if(total_len < lowest_length) {
+            lowest_len_pos = intersection;
+            lowest_length = total_len;
         }
-
-        return false;
     }
-};
-
-std::vector<Point> convert_directions_to_point_list(std::vector<std::string> directions) {
-
-    std::vector<Point> points;
-    Point last_point(0, 0);
-    points.push_back(last_point);
-
-    for(int i = 0; i < directions.size(); i++) {
-
-        char direction = directions[i][0];
-        int distance = std::stoi(
-            directions[i].substr(
-                1, 
-                directions[i].length()
-            )
-        );
-
-        Point current_point(points[points.size()-1]);
-        switch(direction) {
-            case 'U':
-                current_point.y += distance;
-                break;
-            case 'D':
-                current_point.y -= distance;
-                break;
-            case 'L':
-                current_point.x -= distance;
-                break;
-            case 'R':
-                current_point.x += distance;
-                break;
-            default:
-                std::cout << "Encountered unexpected direction '" << direction << "'" << std::endl;
-                exit(-1);
-        }
 
-        points.push_back(current_point);
-    }
+    std::cout << "CLOSEST POINT  : " << lowest_dist_pos.to_string() << std::endl;
+    std::cout << "CLOSEST DIST   : " << lowest_distance << std::endl;
 
-    return points;
+    std::cout << "SHORTEST POINT : " << lowest_len_pos.to_string() << std::endl;
+    std::cout << "SHORTEST DIST  : " << lowest_length << std::endl;
 }
 
-std::vector<std::string> get_directions(std::string wire_description) {
-
-    std::stringstream wire_stream(wire_description);
-    std::vector<std::string> directions;
+/**
+ * Which engine to run, picked on the command line
+ */
+class EngineOptions {
+public:
+    // --brute runs the original every segment against every segment search,
+    // kept as a reference for the sweep
+    bool use_brute_force = false;
+    // --batched tests each segment against runs of presorted perpendicular
+    // segments several at a time
+    bool use_batched = false;
+    // --grid finds crossings between every pair of wires using a WireSet,
+    // always used when there are not exactly two wires
+    bool use_grid = false;
+    // --parallel [threads] splits the plane into strips searched across a
+    // thread pool, by default using every core
+    bool use_parallel = false;
+    // --raster walks every point of both wires through a hash table instead
+    // of intersecting segments, picked by default for two wires made of
+    // short moves unless another engine is asked for
+    bool use_raster = false;
+    // --incremental grows both wires a move at a time, alternating between
+    // them, keeping the answers current after every move
+    bool use_incremental = false;
+    int thread_count = 0;
+};
 
-    while(!wire_stream.eof()) {
-        char buffer[512];
-        wire_stream.getline(buffer, 512, ',');
-        directions.push_back(buffer);
+/**
+ * Find and print the crossings of every wire with the chosen engine, every
+ * engine works with both int and 64 bit coordinates
+ *
+ * @returns exit code
+ */
+template<class T>
+int run_engine(const std::vector<BasicWire<T>>& all_wires, const EngineOptions& options) {
+
+    // both only ever compare a first and a second wire
+    if((options.use_raster || options.use_incremental) && all_wires.size() != 2) {
+        std::cout << "Expected exactly two wires" << std::endl;
+        return -1;
     }
 
-    return directions;
-
-}
+    bool engine_chosen = options.use_brute_force || options.use_batched || options.use_grid ||
+        options.use_parallel || options.use_raster || options.use_incremental;
+    bool use_raster = options.use_raster ||
+        (!engine_chosen && all_wires.size() == 2 && prefer_raster(all_wires[0], all_wires[1]));
+
+    if(options.use_incremental || use_raster || options.use_parallel || options.use_grid || all_wires.size() != 2) {
+        BasicCrossingSummary<T> summary;
+        if(options.use_incremental) {
+            BasicIncrementalCrossings<T> incremental;
+            long longest = std::max(all_wires[0].length, all_wires[1].length);
+            for(long i = 1; i < longest; i++) {
+                if(i < all_wires[0].length) incremental.append(0, all_wires[0].points[i]);
+                if(i < all_wires[1].length) incremental.append(1, all_wires[1].points[i]);
+            }
+            summary = incremental.summary;
+        } else if(use_raster) {
+            summary = find_crossings_raster(all_wires[0], all_wires[1]);
+        } else if(options.use_parallel) {
+            ThreadPool pool(options.thread_count);
+            summary = find_crossings_parallel(all_wires, pool);
+        } else {
+            BasicWireSet<T> wire_set(all_wires);
+            summary = wire_set.summarize();
+        }
 
-std::pair<Wire, Wire> get_wires_from_file(std::string file_location) {
+        std::cout << "WIRES          : " << all_wires.size() << std::endl;
+        std::cout << "CROSSINGS      : " << summary.crossings << std::endl;
 
-    std::ifstream input_file(file_location);
+        std::cout << "CLOSEST POINT  : " << summary.closest.point.to_string() << " (WIRES "
+            << summary.closest.first_wire << ", " << summary.closest.second_wire << ")" << std::endl;
+        std::cout << "CLOSEST DIST   : " << summary.closest_distance << std::endl;
 
-    if(!input_file.is_open()) {
-        std::cout << "Unable to open input file '" << file_location << "'" << std::endl;
-        exit(-1);
-    }
+        std::cout << "SHORTEST POINT : " << summary.shortest.point.to_string() << " (WIRES "
+            << summary.shortest.first_wire << ", " << summary.shortest.second_wire << ")" << std::endl;
+        std::cout << "SHORTEST DIST  : " << summary.shortest.steps << std::endl;
 
-    std::vector<std::string> lines;
-    unsigned int line_number = 0;
-    while(!input_file.eof()) {
-        char buffer[2048];
-        input_file.getline(buffer, 2048);
-        lines.push_back(buffer);
+        return 0;
     }
-    input_file.close();
-
-    return std::pair<Wire, Wire>(
-        Wire(
-            convert_directions_to_point_list(get_directions(lines[0]))),
-        Wire(
-            convert_directions_to_point_list(get_directions(lines[1])))
-    );
-
-}
-
-int get_manhatten_distance(const Point& point) {
-    return std::abs(point.x) + std::abs(point.y);
-}
-
-bool in_range(int child, int parent_a, int parent_b) {
-    return (child <= std::max(parent_a, parent_b) && child >= std::min(parent_a, parent_b));
-}
-
-bool is_line_vertical(const Line& line) {
-    return line.origin.x == line.dest.x;
-}
-
-bool is_line_horizontal(const Line& line) {
-    return line.origin.y == line.dest.y;
-}
-
-Point get_intersection(const Line& a, const Line& b) {
-    Line vertical(is_line_vertical(a) ? a : b);
-    Line horizontal(is_line_horizontal(a) ? a : b);
-
-    return Point(vertical.origin.x, horizontal.origin.y);
-}
-
-bool do_lines_intersect(const Line& line_a, const Line& line_b) {
-    Line vert = is_line_vertical(line_a) ? line_a : line_b;
-    Line hort = is_line_horizontal(line_a) ? line_a : line_b;
-
-    int x1 = std::min(vert.origin.x, vert.dest.x);
-    int y1 = std::min(vert.origin.y, vert.dest.y);
-    int x2 = std::max(vert.origin.x, vert.dest.x);
-    int y2 = std::max(vert.origin.y, vert.dest.y);
 
-    int x3 = std::min(hort.origin.x, hort.dest.x);
-    int y3 = std::min(hort.origin.y, hort.dest.y);
-    int x4 = std::max(hort.origin.x, hort.dest.x);
-    int y4 = std::max(hort.origin.y, hort.dest.y);
+    const BasicWire<T>& first = all_wires[0];
+    const BasicWire<T>& second = all_wires[1];
 
-    // return (
-    //     (x1 >= x3 && x1 <= x4 && x2 >= x3 && x2 <= x4 && y1 <= y3 && y2 >= y4)
-    // );
+    std::vector<BasicCrossing<T>> crossings;
+    if(options.use_brute_force) crossings = find_crossings_brute_force(first, second);
+    else if(options.use_batched) crossings = find_crossings_batched(first, second);
+    else crossings = find_crossings_sweep(first, second);
 
-    Point i = get_intersection(line_a, line_b);
+    report_crossings(first, second, crossings);
 
-    return (
-        i.x >= x3 && i.x <= x4 &&
-        i.y >= y1 && i.y <= y2
-    );
-}
-
-int get_intersection_line_distance(const Line& line, const Point& point) {
-    return std::max( std::abs(point.x - line.origin.x), std::abs(point.y - line.origin.y) );
+    return 0;
 }
 
-#define INPUT_FILE "./test_input"
-
 int main(int argc, char* argv[]) {
 
-    std::pair<Wire, Wire> wires = get_wires_from_file(INPUT_FILE);
-
-    //int line_length = std::min(wires.first.length, wires.second.length);
-    int lowest_distance = 2000;
-    Point lowest_dist_pos(0,0);
-
-    int lowest_length = 40000;
-    Point lowest_len_pos(0, 0);
-
-    for(int i = 0; i < wires.first.length-1; i++) {
-        Line a = wires.first.get_line(i);
-        for(int j = 0; j < wires.second.length-1; j++) {
-            Line b = wires.second.get_line(j);
-
-            if(do_lines_intersect(a, b)) {
-                Point intersection = get_intersection(a, b);
-                int distance = get_manhatten_distance(intersection);
-
-                int a_len = wires.first.get_wire_length(
-                    i, 
-                    get_intersection_line_distance(a, intersection));
-                int b_len = wires.second.get_wire_length(
-                    i, 
-                    get_intersection_line_distance(b, intersection));
-                int total_len = a_len + b_len;
-
-                std::cout << "FOUND INTERSECT AT " << intersection.to_string() 
-                    << ", WITH DISTANCE " << distance 
-                    << ", AND LENGTH " << total_len << std::endl;
-
-                if(distance == 0) continue;
-
-                if(distance < lowest_distance) {
-                    lowest_dist_pos = intersection;
-                    lowest_distance = distance;
-                }
-                if(total_len < lowest_length) {
-                    lowest_len_pos = intersection;
-                    lowest_length = total_len;
-                }
-            }
+    EngineOptions options;
+    // --wide reads the wires with 64 bit coordinates for boards too large
+    // for int
+    bool use_wide = false;
+    // any other argument is the input file
+    std::string input_file = INPUT_FILE;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--brute") == 0) options.use_brute_force = true;
+        else if(strcmp(argv[i], "--batched") == 0) options.use_batched = true;
+        else if(strcmp(argv[i], "--grid") == 0) options.use_grid = true;
+        else if(strcmp(argv[i], "--raster") == 0) options.use_raster = true;
+        else if(strcmp(argv[i], "--incremental") == 0) options.use_incremental = true;
+        else if(strcmp(argv[i], "--wide") == 0) use_wide = true;
+        else if(strcmp(argv[i], "--parallel") == 0) {
+            options.use_parallel = true;
+            if(i + 1 < argc && argv[i+1][0] >= '0' && argv[i+1][0] <= '9') options.thread_count = atoi(argv[++i]);
         }
+        else input_file = argv[i];
     }
 
-    std::cout << "CLOSEST POINT  : " << lowest_dist_pos.to_string() << std::endl;
-    std::cout << "CLOSEST DIST   : " << lowest_distance << std::endl;
-
-    std::cout << "SHORTEST POINT : " << lowest_len_pos.to_string() << std::endl;
-    std::cout << "SHORTEST DIST  : " << lowest_length << std::endl;
+    if(use_wide) return run_engine(get_all_wires_from_file_as<long>(input_file), options);
 
-    return 0;
+    return run_engine(get_all_wires_from_file(input_file), options);
 }
\ No newline at end of file
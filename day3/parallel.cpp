@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "parallel.hpp"
+
+// strips per thread, more than one so that a slow strip does not hold up
+// the whole search
+const int STRIPS_PER_THREAD = 4;
+// vertical x positions sampled per strip when placing strip boundaries
+const int SAMPLES_PER_STRIP = 64;
+
+enum StripEventKind {
+    STRIP_INSERT = 0,
+    STRIP_QUERY = 1,
+    STRIP_REMOVE = 2
+};
+
+/**
+ * A segment copied into a strip, x_min == x_max for verticals and
+ * y_min == y_max for horizontals
+ */
+template<class T>
+class StripSegment {
+public:
+    T x_min, x_max;
+    T y_min, y_max;
+    int wire;
+    int index;
+};
+
+template<class T>
+class StripEvent {
+public:
+    T y;
+    int kind;
+    // index into the strip's segments
+    int segment;
+
+    inline bool operator<(const StripEvent& event) const {
+        return y < event.y || (y == event.y && kind < event.kind);
+    }
+};
+
+template<class T>
+static StripSegment<T> make_strip_segment(const BasicWire<T>& wire, int wire_number, int index) {
+    const BasicPoint<T>& origin = wire.points[index];
+    const BasicPoint<T>& dest = wire.points[index+1];
+
+    return StripSegment<T>{
+        std::min(origin.x, dest.x), std::max(origin.x, dest.x),
+        std::min(origin.y, dest.y), std::max(origin.y, dest.y),
+        wire_number, index
+    };
+}
+
+/**
+ * Place strip boundaries at evenly spaced quantiles of a sample of the
+ * vertical segments' x positions, so each strip holds about as many
+ * verticals no matter how the wires are spread out
+ *
+ * @returns boundaries, strip s covers [bounds[s], bounds[s+1])
+ */
+template<class T>
+static std::vector<T> get_strip_bounds(const std::vector<BasicWire<T>>& wires, long segment_count, int strip_count) {
+    std::vector<T> samples;
+    long stride = std::max(1L, segment_count / ((long)strip_count * SAMPLES_PER_STRIP));
+
+    long flat = 0;
+    for(const BasicWire<T>& wire : wires) {
+        for(int i = 0; i + 1 < wire.length; i++, flat++) {
+            if(flat % stride != 0) continue;
+            if(wire.points[i].x == wire.points[i+1].x) samples.push_back(wire.points[i].x);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+
+    std::vector<T> bounds;
+    bounds.push_back(std::numeric_limits<T>::min());
+    for(int s = 1; s < strip_count && !samples.empty(); s++) {
+        T bound = samples[(size_t)s * samples.size() / strip_count];
+        if(bound > bounds.back()) bounds.push_back(bound);
+    }
+    bounds.push_back(std::numeric_limits<T>::max());
+
+    return bounds;
+}
+
+/**
+ * Sweep a horizontal line upwards over the segments of one strip, only
+ * verticals inside the strip are held so every crossing is found by exactly
+ * one strip even though long horizontals are copied into several
+ */
+template<class T>
+static BasicCrossingSummary<T> sweep_strip(const std::vector<BasicWire<T>>& wires, const std::vector<StripSegment<T>>& segments) {
+    std::vector<StripEvent<T>> events;
+    events.reserve(2 * segments.size());
+
+    for(int i = 0; i < (int)segments.size(); i++) {
+        const StripSegment<T>& segment = segments[i];
+        if(segment.x_min == segment.x_max) {
+            events.push_back(StripEvent<T>{segment.y_min, STRIP_INSERT, i});
+            events.push_back(StripEvent<T>{segment.y_max, STRIP_REMOVE, i});
+        } else {
+            events.push_back(StripEvent<T>{segment.y_min, STRIP_QUERY, i});
+        }
+    }
+    std::sort(events.begin(), events.end());
+
+    std::multimap<T, int> active;
+    std::vector<typename std::multimap<T, int>::iterator> handles(segments.size());
+
+    BasicCrossingSummary<T> summary;
+
+    for(const StripEvent<T>& event : events) {
+        const StripSegment<T>& segment = segments[event.segment];
+
+        switch(event.kind) {
+            case STRIP_INSERT:
+                handles[event.segment] = active.insert({segment.x_min, event.segment});
+                break;
+            case STRIP_REMOVE:
+                active.erase(handles[event.segment]);
+                break;
+            case STRIP_QUERY: {
+                auto end = active.upper_bound(segment.x_max);
+                for(auto it = active.lower_bound(segment.x_min); it != end; it++) {
+                    const StripSegment<T>& vertical = segments[it->second];
+                    if(vertical.wire == segment.wire) continue;
+
+                    BasicPoint<T> point(vertical.x_min, segment.y_min);
+                    long steps = wires[segment.wire].get_steps_to(segment.index, point) +
+                        wires[vertical.wire].get_steps_to(vertical.index, point);
+
+                    if(segment.wire < vertical.wire) {
+                        summary.add(BasicWireCrossing<T>(point, segment.wire, segment.index, vertical.wire, vertical.index, steps));
+                    } else {
+                        summary.add(BasicWireCrossing<T>(point, vertical.wire, vertical.index, segment.wire, segment.index, steps));
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    return summary;
+}
+
+/**
+ * Segments are first bucketed into strips in parallel chunks, each chunk
+ * writing only to its own buckets, then every strip is swept on its own and
+ * the per strip summaries are merged in strip order. Workers share nothing
+ * but read only wires while running, so no locks are taken past handing out
+ * tasks
+ */
+template<class T>
+BasicCrossingSummary<T> find_crossings_parallel(const std::vector<BasicWire<T>>& wires, ThreadPool& pool, int strip_count) {
+    if(strip_count <= 0) strip_count = pool.size() * STRIPS_PER_THREAD;
+
+    // first flat segment index of every wire
+    std::vector<long> wire_start(wires.size() + 1, 0);
+    for(size_t w = 0; w < wires.size(); w++) {
+        wire_start[w + 1] = wire_start[w] + std::max(wires[w].length - 1, 0L);
+    }
+    long segment_count = wire_start.back();
+
+    std::vector<T> bounds = get_strip_bounds(wires, segment_count, strip_count);
+    strip_count = bounds.size() - 1;
+
+    int chunk_count = pool.size();
+    long chunk_size = (segment_count + chunk_count - 1) / chunk_count;
+
+    // buckets[chunk][strip]
+    std::vector<std::vector<std::vector<StripSegment<T>>>> buckets(chunk_count,
+        std::vector<std::vector<StripSegment<T>>>(strip_count));
+
+    pool.parallel_for(chunk_count, [&](int chunk) {
+        long first = chunk * chunk_size;
+        long last = std::min(segment_count, first + chunk_size);
+        if(first >= last) return;
+
+        size_t w = std::upper_bound(wire_start.begin(), wire_start.end(), first) - wire_start.begin() - 1;
+        for(long flat = first; flat < last; flat++) {
+            while(flat >= wire_start[w + 1]) w++;
+
+            StripSegment<T> segment = make_strip_segment(wires[w], w, flat - wire_start[w]);
+
+            int first_strip = std::upper_bound(bounds.begin(), bounds.end(), segment.x_min) - bounds.begin() - 1;
+            int last_strip = first_strip;
+            if(segment.x_min != segment.x_max) {
+                last_strip = std::upper_bound(bounds.begin(), bounds.end(), segment.x_max) - bounds.begin() - 1;
+            }
+
+            for(int strip = first_strip; strip <= last_strip; strip++) {
+                buckets[chunk][strip].push_back(segment);
+            }
+        }
+    });
+
+    std::vector<BasicCrossingSummary<T>> summaries(strip_count);
+
+    pool.parallel_for(strip_count, [&](int strip) {
+        std::vector<StripSegment<T>> segments;
+        for(int chunk = 0; chunk < chunk_count; chunk++) {
+            segments.insert(segments.end(), buckets[chunk][strip].begin(), buckets[chunk][strip].end());
+        }
+
+        summaries[strip] = sweep_strip(wires, segments);
+    });
+
+    BasicCrossingSummary<T> summary;
+    for(const BasicCrossingSummary<T>& strip_summary : summaries) summary.merge(strip_summary);
+
+    return summary;
+}
+
+template CrossingSummary find_crossings_parallel<int>(const std::vector<Wire>& wires, ThreadPool& pool, int strip_count);
+template CrossingSummary64 find_crossings_parallel<long>(const std::vector<Wire64>& wires, ThreadPool& pool, int strip_count);
@@ -0,0 +1,15 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+
+#include "wire.hpp"
+#include "wireset.hpp"
+#include "thread_pool.hpp"
+
+// crossings between every pair of wires, the plane is split into vertical
+// strips which are each swept by a single worker and then combined
+template<class T>
+BasicCrossingSummary<T> find_crossings_parallel(const std::vector<BasicWire<T>>& wires, ThreadPool& pool, int strip_count = 0);
+
+#endif // !PARALLEL_HPP
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "raster.hpp"
+
+// rasterizing costs a hash probe per point against a few log n tree
+// operations per segment, random walks cross over at about this average
+// segment length
+const long RASTER_MAX_AVERAGE_LENGTH = 6;
+// points of the first wire above which the table no longer fits in cache
+// well enough to be worth it
+const long RASTER_MAX_POINTS = 1L << 22;
+
+template<class T>
+BasicStepTable<T>::BasicStepTable(size_t expected_entries) {
+    // at most half full
+    size_t capacity = 16;
+    shift = 60;
+    while(capacity < expected_entries * 2) {
+        capacity *= 2;
+        shift--;
+    }
+
+    keys.assign(capacity, BasicPoint<T>(0, 0));
+    steps.assign(capacity, 0);
+    indices.assign(capacity, -1);
+    verticals.assign(capacity, false);
+    mask = capacity - 1;
+}
+
+template<class T>
+void BasicStepTable<T>::insert(const BasicPoint<T>& point, long steps, int index, bool vertical) {
+    uint64_t slot = get_home(point);
+    while(indices[slot] >= 0) slot = (slot + 1) & mask;
+
+    keys[slot] = point;
+    BasicStepTable::steps[slot] = steps;
+    indices[slot] = index;
+    verticals[slot] = vertical;
+}
+
+template<class T>
+template<class Visitor>
+void BasicStepTable<T>::visit(const BasicPoint<T>& point, Visitor visit) const {
+    for(uint64_t slot = get_home(point); indices[slot] >= 0; slot = (slot + 1) & mask) {
+        if(keys[slot] == point) visit(steps[slot], indices[slot], verticals[slot]);
+    }
+}
+
+template<class T>
+bool prefer_raster(const BasicWire<T>& first, const BasicWire<T>& second) {
+    long segments = std::max(first.length - 1, 0L) + std::max(second.length - 1, 0L);
+    long first_points = first.steps.empty() ? 0 : first.steps.back();
+    long second_points = second.steps.empty() ? 0 : second.steps.back();
+
+    if(first_points > RASTER_MAX_POINTS) return false;
+
+    return first_points + second_points <= RASTER_MAX_AVERAGE_LENGTH * std::max(segments, 1L);
+}
+
+/**
+ * Call visit(point, steps, index, vertical) for every point of every segment
+ * of the wire, both ends included, in the order the wire reaches them. Zero
+ * length segments count as vertical, as with is_line_vertical
+ */
+template<class T, class Visitor>
+static void walk_wire(const BasicWire<T>& wire, Visitor visit) {
+    for(int i = 0; i + 1 < wire.length; i++) {
+        const BasicPoint<T>& origin = wire.points[i];
+        const BasicPoint<T>& dest = wire.points[i+1];
+
+        T dx = (dest.x > origin.x) - (dest.x < origin.x);
+        T dy = (dest.y > origin.y) - (dest.y < origin.y);
+        long length = wire.steps[i+1] - wire.steps[i];
+        bool vertical = origin.x == dest.x;
+
+        BasicPoint<T> point = origin;
+        visit(point, wire.steps[i], i, vertical);
+        for(long step = 1; step <= length; step++) {
+            point.x += dx;
+            point.y += dy;
+            visit(point, wire.steps[i] + step, i, vertical);
+        }
+    }
+}
+
+/**
+ * A perpendicular pair of segments shares exactly one point, so it is found
+ * exactly once, when the second wire's segment walks over that point
+ */
+template<class T>
+BasicCrossingSummary<T> find_crossings_raster(const BasicWire<T>& first, const BasicWire<T>& second) {
+    // every point once per segment, the ends of each segment are walked twice
+    BasicStepTable<T> table((first.steps.empty() ? 0 : first.steps.back()) + first.length);
+    walk_wire(first, [&](const BasicPoint<T>& point, long steps, int index, bool vertical) {
+        table.insert(point, steps, index, vertical);
+    });
+
+    BasicCrossingSummary<T> summary;
+
+    walk_wire(second, [&](const BasicPoint<T>& point, long steps, int index, bool vertical) {
+        table.visit(point, [&](long first_steps, int first_index, bool first_vertical) {
+            if(first_vertical == vertical) return;
+            summary.add(BasicWireCrossing<T>(point, 0, first_index, 1, index, first_steps + steps));
+        });
+    });
+
+    return summary;
+}
+
+template class BasicStepTable<int>;
+template class BasicStepTable<long>;
+template bool prefer_raster<int>(const Wire& first, const Wire& second);
+template bool prefer_raster<long>(const Wire64& first, const Wire64& second);
+template CrossingSummary find_crossings_raster<int>(const Wire& first, const Wire& second);
+template CrossingSummary64 find_crossings_raster<long>(const Wire64& first, const Wire64& second);
@@ -0,0 +1,57 @@
+#ifndef RASTER_HPP
+#define RASTER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "wire.hpp"
+#include "wireset.hpp"
+
+/**
+ * Open addressing hash table from a grid point to every segment passing
+ * through it, with the steps taken to reach the point along that segment,
+ * sized once up front so inserting never allocates. A point is stored once
+ * per segment, so corners and points a wire reaches again have several
+ * entries. An index of -1 marks an empty slot
+ */
+template<class T>
+class BasicStepTable {
+public:
+    BasicStepTable(size_t expected_entries);
+
+    void insert(const BasicPoint<T>& point, long steps, int index, bool vertical);
+
+    // call visit(steps, index, vertical) for every entry of the point
+    template<class Visitor>
+    void visit(const BasicPoint<T>& point, Visitor visit) const;
+
+private:
+    std::vector<BasicPoint<T>> keys;
+    std::vector<long> steps;
+    std::vector<int> indices;
+    std::vector<bool> verticals;
+    uint64_t mask;
+    int shift;
+
+    uint64_t get_home(const BasicPoint<T>& point) const {
+        uint64_t key = (uint64_t)point.x * 0xC2B2AE3D27D4EB4FULL + (uint64_t)point.y;
+        return (key * 0x9E3779B97F4A7C15ULL) >> shift;
+    }
+};
+
+typedef BasicStepTable<int> StepTable;
+typedef BasicStepTable<long> StepTable64;
+
+// true if walking every point of both wires should beat segment geometry
+template<class T>
+bool prefer_raster(const BasicWire<T>& first, const BasicWire<T>& second);
+
+// walks every point of the first wire's segments into a StepTable then looks
+// up every point of the second's, a crossing is a point shared by a vertical
+// of one wire and a horizontal of the other. This counts exactly the segment
+// pairs the segment engines do, so overlapping runs of the wires are not
+// crossings
+template<class T>
+BasicCrossingSummary<T> find_crossings_raster(const BasicWire<T>& first, const BasicWire<T>& second);
+
+#endif // !RASTER_HPP
@@ -0,0 +1,217 @@
+#include <algorithm>
+
+#include "segments.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+template<class T>
+void BasicSegmentArrays<T>::reserve(size_t count) {
+    x_min.reserve(count);
+    x_max.reserve(count);
+    y_min.reserve(count);
+    y_max.reserve(count);
+    BasicSegmentArrays::index.reserve(count);
+}
+
+template<class T>
+void BasicSegmentArrays<T>::push_back(T x_min, T x_max, T y_min, T y_max, int index) {
+    BasicSegmentArrays::x_min.push_back(x_min);
+    BasicSegmentArrays::x_max.push_back(x_max);
+    BasicSegmentArrays::y_min.push_back(y_min);
+    BasicSegmentArrays::y_max.push_back(y_max);
+    BasicSegmentArrays::index.push_back(index);
+}
+
+/**
+ * Split the wire's segments by orientation, then sort each set on its fixed
+ * coordinate. Zero length segments count as vertical, as with
+ * is_line_vertical
+ */
+template<class T>
+BasicSegmentStore<T>::BasicSegmentStore(const BasicWire<T>& wire) {
+    std::vector<int> horizontals, verticals;
+    for(int i = 0; i + 1 < wire.length; i++) {
+        if(wire.points[i].x == wire.points[i+1].x) verticals.push_back(i);
+        else horizontals.push_back(i);
+    }
+
+    std::stable_sort(horizontals.begin(), horizontals.end(), [&](int a, int b) {
+        return wire.points[a].y < wire.points[b].y;
+    });
+    std::stable_sort(verticals.begin(), verticals.end(), [&](int a, int b) {
+        return wire.points[a].x < wire.points[b].x;
+    });
+
+    horizontal.reserve(horizontals.size());
+    vertical.reserve(verticals.size());
+
+    for(int i : horizontals) {
+        const BasicPoint<T>& a = wire.points[i];
+        const BasicPoint<T>& b = wire.points[i+1];
+        horizontal.push_back(std::min(a.x, b.x), std::max(a.x, b.x), a.y, a.y, i);
+    }
+    for(int i : verticals) {
+        const BasicPoint<T>& a = wire.points[i];
+        const BasicPoint<T>& b = wire.points[i+1];
+        vertical.push_back(a.x, a.x, std::min(a.y, b.y), std::max(a.y, b.y), i);
+    }
+}
+
+/**
+ * Write the positions in [begin, end) where low[i] <= value <= high[i]
+ *
+ * @returns amount of positions written to matches
+ */
+template<class T>
+static int filter_range_scalar(const T* low, const T* high, T value, int begin, int end, int* matches) {
+    int count = 0;
+    for(int i = begin; i < end; i++) {
+        // branchless so the loop vectorizes when optimizing
+        matches[count] = i;
+        count += (low[i] <= value) & (value <= high[i]);
+    }
+    return count;
+}
+
+#ifdef HAVE_AVX2_KERNEL
+/**
+ * Same as filter_range_scalar, 8 int candidates per compare
+ */
+__attribute__((target("avx2")))
+static int filter_range_avx2(const int* low, const int* high, int value, int begin, int end, int* matches) {
+    __m256i values = _mm256_set1_epi32(value);
+    int count = 0;
+    int i = begin;
+
+    for(; i + 8 <= end; i += 8) {
+        __m256i lows = _mm256_loadu_si256((const __m256i*)(low + i));
+        __m256i highs = _mm256_loadu_si256((const __m256i*)(high + i));
+
+        // low > value or value > high means no match
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lows, values), _mm256_cmpgt_epi32(values, highs));
+        unsigned int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xff;
+
+        while(mask) {
+            matches[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return count + filter_range_scalar(low, high, value, i, end, matches + count);
+}
+
+/**
+ * Same as filter_range_scalar, 4 64 bit candidates per compare
+ */
+__attribute__((target("avx2")))
+static int filter_range_avx2(const long* low, const long* high, long value, int begin, int end, int* matches) {
+    __m256i values = _mm256_set1_epi64x(value);
+    int count = 0;
+    int i = begin;
+
+    for(; i + 4 <= end; i += 4) {
+        __m256i lows = _mm256_loadu_si256((const __m256i*)(low + i));
+        __m256i highs = _mm256_loadu_si256((const __m256i*)(high + i));
+
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lows, values), _mm256_cmpgt_epi64(values, highs));
+        unsigned int mask = ~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xf;
+
+        while(mask) {
+            matches[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return count + filter_range_scalar(low, high, value, i, end, matches + count);
+}
+#endif
+
+template<class T>
+using FilterRange = int (*)(const T*, const T*, T, int, int, int*);
+
+template<class T>
+static FilterRange<T> get_filter_range(void) {
+#ifdef HAVE_AVX2_KERNEL
+    if(__builtin_cpu_supports("avx2")) return filter_range_avx2;
+#endif
+    return filter_range_scalar<T>;
+}
+
+/**
+ * Find every crossing of one set of segments with the perpendicular set,
+ * candidates are found by binary searching the sorted fixed coordinate and
+ * then filtered on their range in batches
+ *
+ * @param segments segments of one orientation from one wire
+ * @param candidates perpendicular segments from the other wire
+ * @param segments_vertical true if segments are the verticals
+ * @param found called with (segment index, candidate index, point)
+ */
+template<class T, class Found>
+static void find_perpendicular(const BasicSegmentArrays<T>& segments, const BasicSegmentArrays<T>& candidates,
+    bool segments_vertical, FilterRange<T> filter_range, std::vector<int>& matches, Found found) {
+
+    // the candidates' fixed coordinate, and the range tested against it
+    const std::vector<T>& fixed = segments_vertical ? candidates.y_min : candidates.x_min;
+    const std::vector<T>& low = segments_vertical ? candidates.x_min : candidates.y_min;
+    const std::vector<T>& high = segments_vertical ? candidates.x_max : candidates.y_max;
+
+    for(int s = 0; s < segments.size(); s++) {
+        T range_min = segments_vertical ? segments.y_min[s] : segments.x_min[s];
+        T range_max = segments_vertical ? segments.y_max[s] : segments.x_max[s];
+        T value = segments_vertical ? segments.x_min[s] : segments.y_min[s];
+
+        int begin = std::lower_bound(fixed.begin(), fixed.end(), range_min) - fixed.begin();
+        int end = std::upper_bound(fixed.begin() + begin, fixed.end(), range_max) - fixed.begin();
+        if(begin == end) continue;
+
+        if((int)matches.size() < end - begin) matches.resize(end - begin);
+        int count = filter_range(low.data(), high.data(), value, begin, end, matches.data());
+
+        for(int m = 0; m < count; m++) {
+            int c = matches[m];
+            BasicPoint<T> point = segments_vertical ? BasicPoint<T>(value, fixed[c]) : BasicPoint<T>(fixed[c], value);
+            found(segments.index[s], candidates.index[c], point);
+        }
+    }
+}
+
+/**
+ * Only perpendicular crossings are reported, as with the sweep, in the same
+ * order as brute force
+ */
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_batched(const BasicSegmentStore<T>& a, const BasicSegmentStore<T>& b) {
+    FilterRange<T> filter_range = get_filter_range<T>();
+    std::vector<int> matches;
+    std::vector<BasicCrossing<T>> crossings;
+
+    find_perpendicular(a.horizontal, b.vertical, false, filter_range, matches,
+        [&](int i, int j, const BasicPoint<T>& point) { crossings.push_back(BasicCrossing<T>(point, i, j)); });
+    find_perpendicular(a.vertical, b.horizontal, true, filter_range, matches,
+        [&](int i, int j, const BasicPoint<T>& point) { crossings.push_back(BasicCrossing<T>(point, i, j)); });
+
+    std::sort(crossings.begin(), crossings.end(), [](const BasicCrossing<T>& a, const BasicCrossing<T>& b) {
+        return a.first_index < b.first_index ||
+            (a.first_index == b.first_index && a.second_index < b.second_index);
+    });
+
+    return crossings;
+}
+
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_batched(const BasicWire<T>& first, const BasicWire<T>& second) {
+    return find_crossings_batched(BasicSegmentStore<T>(first), BasicSegmentStore<T>(second));
+}
+
+template class BasicSegmentArrays<int>;
+template class BasicSegmentArrays<long>;
+template class BasicSegmentStore<int>;
+template class BasicSegmentStore<long>;
+template std::vector<Crossing> find_crossings_batched<int>(const SegmentStore& first, const SegmentStore& second);
+template std::vector<Crossing64> find_crossings_batched<long>(const SegmentStore64& first, const SegmentStore64& second);
+template std::vector<Crossing> find_crossings_batched<int>(const Wire& first, const Wire& second);
+template std::vector<Crossing64> find_crossings_batched<long>(const Wire64& first, const Wire64& second);
@@ -0,0 +1,52 @@
+#ifndef SEGMENTS_HPP
+#define SEGMENTS_HPP
+
+#include <vector>
+
+#include "wire.hpp"
+#include "intersect.hpp"
+
+/**
+ * One orientation of a wire's segments stored as parallel arrays, index is
+ * the segment's line index in the wire
+ */
+template<class T>
+class BasicSegmentArrays {
+public:
+    std::vector<T> x_min, x_max;
+    std::vector<T> y_min, y_max;
+    std::vector<int> index;
+
+    int size(void) const { return index.size(); }
+
+    void reserve(size_t count);
+    void push_back(T x_min, T x_max, T y_min, T y_max, int index);
+};
+
+/**
+ * Structure of arrays copy of a wire, horizontals are sorted by y and
+ * verticals by x so that a perpendicular segment only has to be tested
+ * against the run of candidates whose fixed coordinate lies in its range
+ */
+template<class T>
+class BasicSegmentStore {
+public:
+    BasicSegmentArrays<T> horizontal;
+    BasicSegmentArrays<T> vertical;
+
+    BasicSegmentStore(const BasicWire<T>& wire);
+};
+
+typedef BasicSegmentArrays<int> SegmentArrays;
+typedef BasicSegmentArrays<long> SegmentArrays64;
+typedef BasicSegmentStore<int> SegmentStore;
+typedef BasicSegmentStore<long> SegmentStore64;
+
+// tests the candidate runs a few segments at a time, with AVX2 when the cpu
+// has it, 8 candidates per compare for int coordinates and 4 for 64 bit
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_batched(const BasicSegmentStore<T>& first, const BasicSegmentStore<T>& second);
+template<class T>
+std::vector<BasicCrossing<T>> find_crossings_batched(const BasicWire<T>& first, const BasicWire<T>& second);
+
+#endif // !SEGMENTS_HPP
@@ -0,0 +1,103 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads which run parallel for loops, tasks are handed
+ * out through an atomic counter so the workers never take a lock while a
+ * loop is running
+ */
+class ThreadPool {
+public:
+    ThreadPool(int thread_count = 0) : stopping(false), generation(0), active(0) {
+        if(thread_count <= 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        // the calling thread also takes part in every loop
+        for(int i = 1; i < thread_count; i++) {
+            workers.push_back(std::thread([this]() { work(); }));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size(void) const {
+        return workers.size() + 1;
+    }
+
+    /**
+     * Call task(i) for every i in [0, count) spread over every thread, returns
+     * once every task has finished
+     */
+    void parallel_for(int count, std::function<void(int)> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current_task = task;
+            task_count = count;
+            next_task = 0;
+            active = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        run_tasks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return active == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping;
+    unsigned long generation;
+    size_t active;
+
+    std::function<void(int)> current_task;
+    int task_count;
+    std::atomic<int> next_task;
+
+    void run_tasks(void) {
+        int task;
+        while((task = next_task.fetch_add(1)) < task_count) current_task(task);
+    }
+
+    void work(void) {
+        unsigned long seen = 0;
+        while(true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if(stopping) return;
+                seen = generation;
+            }
+
+            run_tasks();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+            }
+            done.notify_one();
+        }
+    }
+};
+
+#endif // !THREAD_POOL_HPP
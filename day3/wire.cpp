@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wire.hpp"
+
+/**
+ * Parse every wire from a buffer holding one wire description per line in a
+ * single pass, turning each direction straight into a point without any
+ * intermediate strings. Lines may be any length, blank lines are skipped.
+ * Exits if a coordinate does not fit in T
+ */
+template<class T>
+std::vector<BasicWire<T>> parse_wires_as(const char* data, size_t size) {
+
+    std::vector<BasicWire<T>> wires;
+    const char* position = data;
+    const char* end = data + size;
+    bool overflow = false;
+
+    while(position < end) {
+        const char* line_end = (const char*)memchr(position, '\n', end - position);
+        if(line_end == nullptr) line_end = end;
+
+        std::vector<BasicPoint<T>> points;
+        points.reserve(std::count(position, line_end, ',') + 2);
+        points.push_back(BasicPoint<T>(0, 0));
+
+        T x = 0, y = 0;
+        while(position < line_end) {
+            char direction = *position++;
+            if(direction == ',' || direction == '\r' || direction == ' ') continue;
+
+            T distance = 0;
+            while(position < line_end && *position >= '0' && *position <= '9') {
+                overflow |= __builtin_mul_overflow(distance, (T)10, &distance);
+                overflow |= __builtin_add_overflow(distance, (T)(*position++ - '0'), &distance);
+            }
+
+            switch(direction) {
+                case 'U':
+                    overflow |= __builtin_add_overflow(y, distance, &y);
+                    break;
+                case 'D':
+                    overflow |= __builtin_sub_overflow(y, distance, &y);
+                    break;
+                case 'L':
+                    overflow |= __builtin_sub_overflow(x, distance, &x);
+                    break;
+                case 'R':
+                    overflow |= __builtin_add_overflow(x, distance, &x);
+                    break;
+                default:
+                    std::cout << "Encountered unexpected direction '" << direction << "'" << std::endl;
+                    exit(-1);
+            }
+
+            if(overflow) {
+                std::cout << "Wire coordinates do not fit in " << 8 * sizeof(T) << " bits" << std::endl;
+                exit(-1);
+            }
+
+            points.push_back(BasicPoint<T>(x, y));
+        }
+        position = line_end + 1;
+
+        if(points.size() > 1) wires.push_back(BasicWire<T>(std::move(points)));
+    }
+
+    return wires;
+}
+
+template<class T>
+std::vector<BasicWire<T>> get_all_wires_from_file_as(std::string file_location) {
+
+    int descriptor = open(file_location.c_str(), O_RDONLY);
+
+    if(descriptor < 0) {
+        std::cout << "Unable to open input file '" << file_location << "'" << std::endl;
+        exit(-1);
+    }
+
+    struct stat info;
+    fstat(descriptor, &info);
+    size_t size = info.st_size;
+
+    if(size == 0) {
+        close(descriptor);
+        return std::vector<BasicWire<T>>();
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if(data == MAP_FAILED) {
+        std::cout << "Unable to map input file '" << file_location << "'" << std::endl;
+        close(descriptor);
+        exit(-1);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    std::vector<BasicWire<T>> wires = parse_wires_as<T>((const char*)data, size);
+
+    munmap(data, size);
+    close(descriptor);
+
+    return wires;
+}
+
+template std::vector<Wire> parse_wires_as<int>(const char* data, size_t size);
+template std::vector<Wire64> parse_wires_as<long>(const char* data, size_t size);
+template std::vector<Wire> get_all_wires_from_file_as<int>(std::string file_location);
+template std::vector<Wire64> get_all_wires_from_file_as<long>(std::string file_location);
+
+std::vector<Wire> parse_wires(const char* data, size_t size) {
+    return parse_wires_as<int>(data, size);
+}
+
+std::vector<Wire> get_all_wires_from_file(std::string file_location) {
+    return get_all_wires_from_file_as<int>(file_location);
+}
+
+// no more than the steps a wire takes to reach the point, so neither
+// overflows for a point on a wire
+long get_manhatten_distance(const Point& point) {
+    return std::abs((long)point.x) + std::abs((long)point.y);
+}
+
+long get_manhatten_distance(const Point64& point) {
+    return std::abs(point.x) + std::abs(point.y);
+}
+
+template<class T>
+bool in_range(T child, T parent_a, T parent_b) {
+    return (child <= std::max(parent_a, parent_b) && child >= std::min(parent_a, parent_b));
+}
+
+template<class T>
+bool is_line_vertical(const BasicLine<T>& line) {
+    return line.origin.x == line.dest.x;
+}
+
+template<class T>
+bool is_line_horizontal(const BasicLine<T>& line) {
+    return line.origin.y == line.dest.y;
+}
+
+template<class T>
+BasicPoint<T> get_intersection(const BasicLine<T>& a, const BasicLine<T>& b) {
+    const BasicLine<T>& vertical = is_line_vertical(a) ? a : b;
+    const BasicLine<T>& horizontal = is_line_horizontal(a) ? a : b;
+
+    return BasicPoint<T>(vertical.origin.x, horizontal.origin.y);
+}
+
+template<class T>
+bool do_lines_intersect(const BasicLine<T>& line_a, const BasicLine<T>& line_b) {
+    const BasicLine<T>& vert = is_line_vertical(line_a) ? line_a : line_b;
+    const BasicLine<T>& hort = is_line_horizontal(line_a) ? line_a : line_b;
+
+    BasicPoint<T> i = get_intersection(line_a, line_b);
+
+    return (
+        in_range(i.x, hort.origin.x, hort.dest.x) &&
+        in_range(i.y, vert.origin.y, vert.dest.y)
+    );
+}
+
+template<class T>
+long get_intersection_line_distance(const BasicLine<T>& line, const BasicPoint<T>& point) {
+    return std::max( std::abs((long)point.x - line.origin.x), std::abs((long)point.y - line.origin.y) );
+}
+
+template bool in_range<int>(int child, int parent_a, int parent_b);
+template bool in_range<long>(long child, long parent_a, long parent_b);
+template bool is_line_vertical<int>(const Line& line);
+template bool is_line_vertical<long>(const Line64& line);
+template bool is_line_horizontal<int>(const Line& line);
+template bool is_line_horizontal<long>(const Line64& line);
+template Point get_intersection<int>(const Line& a, const Line& b);
+template Point64 get_intersection<long>(const Line64& a, const Line64& b);
+template bool do_lines_intersect<int>(const Line& line_a, const Line& line_b);
+template bool do_lines_intersect<long>(const Line64& line_a, const Line64& line_b);
+template long get_intersection_line_distance<int>(const Line& line, const Point& point);
+template long get_intersection_line_distance<long>(const Line64& line, const Point64& point);
@@ -0,0 +1,182 @@
+#ifndef WIRE_HPP
+#define WIRE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// geometry is templated over the coordinate type, the puzzle fits in int
+// while generated boards may need 64 bit coordinates. All of these are
+// plain values so arrays of them can be copied or mapped as raw memory
+
+template<class T>
+class BasicPoint {
+public:
+    T x, y;
+    BasicPoint() = default;
+    BasicPoint(T x, T y) : x(x), y(y) {}
+
+    inline bool operator==(const BasicPoint& point) const {
+        return x == point.x && y == point.y;
+    }
+
+    std::string to_string(void) const {
+        return "(" + std::to_string(x) + ", " + std::to_string(y) + ")";
+    }
+};
+
+template<class T>
+class BasicLine {
+public:
+    BasicPoint<T> origin;
+    BasicPoint<T> dest;
+    BasicLine() = default;
+    BasicLine(const BasicPoint<T>& origin, const BasicPoint<T>& dest) : origin(origin), dest(dest) {}
+
+    std::string to_string(void) const {
+        return origin.to_string() + " --- " + dest.to_string(); 
+    }
+
+    long length(void) const {
+        return std::max( std::abs((long)origin.x - dest.x), std::abs((long)origin.y - dest.y) );
+    }
+};
+
+// a wire takes at most this many steps, so the combined steps of two wires
+// to a crossing always fit in a long
+const long MAX_WIRE_STEPS = std::numeric_limits<long>::max() / 2;
+
+/**
+ * Wires own their point and step arrays and are only ever moved, from the
+ * parser into the wire list and on into any index built over them. Steps
+ * are 64 bit whatever the coordinate type, a wire exits with an error if
+ * they pass MAX_WIRE_STEPS
+ */
+template<class T>
+class BasicWire {
+public:
+    std::vector<BasicPoint<T>> points;
+    long length;
+    // steps[i] is the amount of steps taken along the wire to reach points[i]
+    std::vector<long> steps;
+
+    BasicWire(std::vector<BasicPoint<T>> points) {
+        BasicWire::points = std::move(points);
+        BasicWire::length = BasicWire::points.size();
+
+        steps.reserve(length);
+        steps.push_back(0);
+        for(long i = 0; i + 1 < length; i++) {
+            add_steps(BasicWire::points[i], BasicWire::points[i+1]);
+        }
+    }
+
+    BasicWire(BasicWire&&) = default;
+    BasicWire& operator=(BasicWire&&) = default;
+    BasicWire(const BasicWire&) = delete;
+    BasicWire& operator=(const BasicWire&) = delete;
+
+    // extend the wire to a new end point
+    void append(const BasicPoint<T>& point) {
+        add_steps(points.back(), point);
+        points.push_back(point);
+        length++;
+    }
+
+    BasicLine<T> get_line(int index) const {
+        if(index == points.size()) index-=1;
+
+        return BasicLine<T>(points[index], points[index+1]);
+    }
+
+    long get_wire_length(int index, long offset) const {
+        return steps[index] + offset;
+    }
+
+    // steps along the wire to reach a point lying on the line at index, no
+    // more than steps[index+1] so this cannot overflow
+    long get_steps_to(int index, const BasicPoint<T>& point) const {
+        const BasicPoint<T>& origin = points[index];
+        return steps[index] + (long)std::max( get_gap(origin.x, point.x), get_gap(origin.y, point.y) );
+    }
+
+    bool does_wire_intersect(T x, T y) const {
+        for(int i = 0; i < points.size() - 1; i++) {
+            const BasicPoint<T>* a = &points[i];
+            const BasicPoint<T>* b = &points[i+1];
+
+            // this is an x crossing
+            if(a->x == b->x) {
+                if(x <= std::max(a->x, b->x) && x >= std::min(a->x, b->x)) {
+                    return true;
+                }
+            }
+            // this is a y crossing
+            if(a->y == b->y) {
+                if(y <= std::max(a->y, b->y) && y >= std::min(a->y, b->y)) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+private:
+    // distance between two coordinates, unsigned so it never overflows
+    static unsigned long get_gap(T a, T b) {
+        return (a < b) ? (unsigned long)b - a : (unsigned long)a - b;
+    }
+
+    // push the steps reaching b from a, which lie in line
+    void add_steps(const BasicPoint<T>& a, const BasicPoint<T>& b) {
+        unsigned long move = std::max( get_gap(a.x, b.x), get_gap(a.y, b.y) );
+        if(move > (unsigned long)(MAX_WIRE_STEPS - steps.back())) {
+            std::cout << "Wire takes more than " << MAX_WIRE_STEPS << " steps" << std::endl;
+            exit(-1);
+        }
+        steps.push_back(steps.back() + move);
+    }
+};
+
+typedef BasicPoint<int> Point;
+typedef BasicLine<int> Line;
+typedef BasicWire<int> Wire;
+
+typedef BasicPoint<long> Point64;
+typedef BasicLine<long> Line64;
+typedef BasicWire<long> Wire64;
+
+static_assert(std::is_trivially_copyable<Point>::value && std::is_trivially_copyable<Point64>::value,
+    "points must be plain values");
+static_assert(std::is_trivially_copyable<Line>::value && std::is_trivially_copyable<Line64>::value,
+    "lines must be plain values");
+
+template<class T>
+std::vector<BasicWire<T>> parse_wires_as(const char* data, size_t size);
+template<class T>
+std::vector<BasicWire<T>> get_all_wires_from_file_as(std::string file_location);
+std::vector<Wire> parse_wires(const char* data, size_t size);
+std::vector<Wire> get_all_wires_from_file(std::string file_location);
+
+long get_manhatten_distance(const Point& point);
+long get_manhatten_distance(const Point64& point);
+template<class T>
+bool in_range(T child, T parent_a, T parent_b);
+template<class T>
+bool is_line_vertical(const BasicLine<T>& line);
+template<class T>
+bool is_line_horizontal(const BasicLine<T>& line);
+template<class T>
+BasicPoint<T> get_intersection(const BasicLine<T>& a, const BasicLine<T>& b);
+template<class T>
+bool do_lines_intersect(const BasicLine<T>& line_a, const BasicLine<T>& line_b);
+template<class T>
+long get_intersection_line_distance(const BasicLine<T>& line, const BasicPoint<T>& point);
+
+#endif // !WIRE_HPP
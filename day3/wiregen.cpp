@@ -0,0 +1,35 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "generator.hpp"
+
+/* Writes synthetic wire boards to stdout, see print_usage */
+
+void print_usage(void) {
+    std::cout << "usage: wiregen [--segments N] [--wires N] [--density D] [--adversarial] "
+        "[--max-move N] [--seed N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+
+    GeneratorOptions options;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--adversarial") == 0) options.mode = GENERATE_ADVERSARIAL;
+        else if(strcmp(argv[i], "--random") == 0) options.mode = GENERATE_RANDOM;
+        else if(i + 1 < argc && strcmp(argv[i], "--segments") == 0) options.segments = atof(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--wires") == 0) options.wires = atoi(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--density") == 0) options.density = atof(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--max-move") == 0) options.max_move = atoi(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "--seed") == 0) options.seed = strtoul(argv[++i], nullptr, 10);
+        else {
+            print_usage();
+            return -1;
+        }
+    }
+
+    std::cout << generate_wires(options);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "wireset.hpp"
+
+// the grid is kept at or below this many cells a side
+const int MAX_GRID_SIDE = 4096;
+
+template<class T>
+void BasicCrossingSummary<T>::add(const BasicWireCrossing<T>& crossing) {
+    crossings++;
+
+    long distance = get_manhatten_distance(crossing.point);
+    if(distance == 0) return;
+
+    if(!found || distance < closest_distance) {
+        closest = crossing;
+        closest_distance = distance;
+    }
+    if(!found || crossing.steps < shortest.steps) {
+        shortest = crossing;
+    }
+    found = true;
+}
+
+/**
+ * Combine with a summary of other crossings, ties keep this summary's
+ * crossing so merging in a fixed order gives a fixed answer
+ */
+template<class T>
+void BasicCrossingSummary<T>::merge(const BasicCrossingSummary& summary) {
+    crossings += summary.crossings;
+    if(!summary.found) return;
+
+    if(!found || summary.closest_distance < closest_distance) {
+        closest = summary.closest;
+        closest_distance = summary.closest_distance;
+    }
+    if(!found || summary.shortest.steps < shortest.steps) {
+        shortest = summary.shortest;
+    }
+    found = true;
+}
+
+/**
+ * Build the grid, by default cells are sized so that there are about as many
+ * cells as segments while an average segment spans only a couple of cells
+ */
+template<class T>
+BasicWireSet<T>::BasicWireSet(const std::vector<BasicWire<T>>& wires, long cell_size) : wires(wires) {
+    min_x = min_y = std::numeric_limits<T>::max();
+    T max_x = std::numeric_limits<T>::min(), max_y = std::numeric_limits<T>::min();
+    long segment_count = 0;
+    double total_length = 0;
+
+    for(const BasicWire<T>& wire : BasicWireSet::wires) {
+        for(const BasicPoint<T>& point : wire.points) {
+            min_x = std::min(min_x, point.x);
+            min_y = std::min(min_y, point.y);
+            max_x = std::max(max_x, point.x);
+            max_y = std::max(max_y, point.y);
+        }
+        segment_count += std::max(wire.length - 1, 0L);
+        total_length += wire.steps.empty() ? 0 : wire.steps.back();
+    }
+
+    if(segment_count == 0) {
+        min_x = min_y = max_x = max_y = 0;
+    }
+
+    // one less than the width and height, which may not fit in T
+    unsigned long span_x = (unsigned long)max_x - min_x;
+    unsigned long span_y = (unsigned long)max_y - min_y;
+
+    if(cell_size <= 0) {
+        double area_per_segment = std::sqrt(((double)span_x + 1) * ((double)span_y + 1) / std::max(segment_count, 1L));
+        double average_length = total_length / std::max(segment_count, 1L);
+        cell_size = (long)std::min(std::max(1.0, std::max(area_per_segment, average_length)),
+            (double)std::numeric_limits<long>::max() / 2);
+    }
+
+    BasicWireSet::cell_size = std::max((unsigned long)cell_size, std::max(span_x, span_y) / MAX_GRID_SIDE + 1);
+    columns = span_x / BasicWireSet::cell_size + 1;
+    rows = span_y / BasicWireSet::cell_size + 1;
+
+    // count the segments in each cell, then fill them in, leaving every
+    // cell's segments next to each other
+    cell_start.assign((size_t)columns * rows + 1, 0);
+
+    for(int pass = 0; pass < 2; pass++) {
+        std::vector<int> fill;
+        if(pass == 1) {
+            for(size_t i = 1; i < cell_start.size(); i++) cell_start[i] += cell_start[i-1];
+            segments.resize(cell_start.back());
+            fill.assign(cell_start.begin(), cell_start.end() - 1);
+        }
+
+        for(int w = 0; w < (int)BasicWireSet::wires.size(); w++) {
+            const BasicWire<T>& wire = BasicWireSet::wires[w];
+            for(int i = 0; i + 1 < wire.length; i++) {
+                const BasicPoint<T>& a = wire.points[i];
+                const BasicPoint<T>& b = wire.points[i+1];
+
+                int first_column = get_column(std::min(a.x, b.x));
+                int last_column = get_column(std::max(a.x, b.x));
+                int first_row = get_row(std::min(a.y, b.y));
+                int last_row = get_row(std::max(a.y, b.y));
+
+                for(int row = first_row; row <= last_row; row++) {
+                    for(int column = first_column; column <= last_column; column++) {
+                        size_t cell = (size_t)row * columns + column;
+                        if(pass == 0) cell_start[cell + 1]++;
+                        else segments[fill[cell]++] = SegmentRef{w, i};
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Call visit for every crossing between segments of two different wires,
+ * a crossing is only reported by the cell its point lies in so segments
+ * sharing several cells are not reported more than once
+ */
+template<class T>
+template<class Visitor>
+void BasicWireSet<T>::visit_crossings(Visitor visit) const {
+    for(int row = 0; row < rows; row++) {
+        for(int column = 0; column < columns; column++) {
+            size_t cell = (size_t)row * columns + column;
+
+            for(int i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+                const SegmentRef& first = segments[i];
+                BasicLine<T> a = wires[first.wire].get_line(first.index);
+
+                for(int j = i + 1; j < cell_start[cell + 1]; j++) {
+                    const SegmentRef& second = segments[j];
+                    if(first.wire == second.wire) continue;
+
+                    BasicLine<T> b = wires[second.wire].get_line(second.index);
+
+                    // only perpendicular segments cross at a single point
+                    if(is_line_vertical(a) == is_line_vertical(b)) continue;
+                    if(!do_lines_intersect(a, b)) continue;
+
+                    BasicPoint<T> point = get_intersection(a, b);
+                    if(get_column(point.x) != column || get_row(point.y) != row) continue;
+
+                    long steps = wires[first.wire].get_steps_to(first.index, point) +
+                        wires[second.wire].get_steps_to(second.index, point);
+
+                    if(first.wire < second.wire) {
+                        visit(BasicWireCrossing<T>(point, first.wire, first.index, second.wire, second.index, steps));
+                    } else {
+                        visit(BasicWireCrossing<T>(point, second.wire, second.index, first.wire, first.index, steps));
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<class T>
+std::vector<BasicWireCrossing<T>> BasicWireSet<T>::find_all_crossings(void) const {
+    std::vector<BasicWireCrossing<T>> crossings;
+    visit_crossings([&](const BasicWireCrossing<T>& crossing) { crossings.push_back(crossing); });
+
+    return crossings;
+}
+
+/**
+ * Find the closest crossing and the crossing with the fewest combined steps
+ * over every pair of wires in one walk of the grid
+ */
+template<class T>
+BasicCrossingSummary<T> BasicWireSet<T>::summarize(void) const {
+    BasicCrossingSummary<T> summary;
+    visit_crossings([&](const BasicWireCrossing<T>& crossing) { summary.add(crossing); });
+
+    return summary;
+}
+
+template class BasicCrossingSummary<int>;
+template class BasicCrossingSummary<long>;
+template class BasicWireSet<int>;
+template class BasicWireSet<long>;
@@ -0,0 +1,95 @@
+#ifndef WIRESET_HPP
+#define WIRESET_HPP
+
+#include <vector>
+
+#include "wire.hpp"
+
+/**
+ * A crossing between segments of two different wires in a WireSet, steps is
+ * the combined amount of steps both wires take to reach it
+ */
+template<class T>
+class BasicWireCrossing {
+public:
+    BasicPoint<T> point;
+    int first_wire, first_index;
+    int second_wire, second_index;
+    long steps;
+
+    BasicWireCrossing(const BasicPoint<T>& point, int first_wire, int first_index,
+        int second_wire, int second_index, long steps) :
+        point(point), first_wire(first_wire), first_index(first_index),
+        second_wire(second_wire), second_index(second_index), steps(steps) {}
+};
+
+/**
+ * Answers to every query at once, crossings at the origin are not counted
+ * as closest or shortest since every wire starts there
+ */
+template<class T>
+class BasicCrossingSummary {
+public:
+    long crossings;
+    bool found;
+    BasicWireCrossing<T> closest;
+    long closest_distance;
+    BasicWireCrossing<T> shortest;
+
+    BasicCrossingSummary() : crossings(0), found(false),
+        closest(BasicPoint<T>(0, 0), -1, -1, -1, -1, 0), closest_distance(0),
+        shortest(BasicPoint<T>(0, 0), -1, -1, -1, -1, 0) {}
+
+    void add(const BasicWireCrossing<T>& crossing);
+    void merge(const BasicCrossingSummary& summary);
+};
+
+typedef BasicWireCrossing<int> WireCrossing;
+typedef BasicWireCrossing<long> WireCrossing64;
+typedef BasicCrossingSummary<int> CrossingSummary;
+typedef BasicCrossingSummary<long> CrossingSummary64;
+
+/**
+ * Any amount of wires sharing a uniform grid of their segments, each grid
+ * cell lists every segment passing through it so that only segments sharing
+ * a cell are ever tested against each other. The wires are not copied and
+ * must outlive the set
+ */
+template<class T>
+class BasicWireSet {
+public:
+    const std::vector<BasicWire<T>>& wires;
+
+    BasicWireSet(const std::vector<BasicWire<T>>& wires, long cell_size = 0);
+
+    std::vector<BasicWireCrossing<T>> find_all_crossings(void) const;
+    BasicCrossingSummary<T> summarize(void) const;
+
+private:
+    // a segment within a cell, index is the line index in its wire
+    class SegmentRef {
+    public:
+        int wire;
+        int index;
+    };
+
+    // offsets from the grid's corner are taken unsigned, so a board spanning
+    // the whole coordinate range does not overflow
+    unsigned long cell_size;
+    T min_x, min_y;
+    int columns, rows;
+    // cell_start[c] to cell_start[c+1] are the indices into segments for cell c
+    std::vector<int> cell_start;
+    std::vector<SegmentRef> segments;
+
+    int get_column(T x) const { return ((unsigned long)x - min_x) / cell_size; }
+    int get_row(T y) const { return ((unsigned long)y - min_y) / cell_size; }
+
+    template<class Visitor>
+    void visit_crossings(Visitor visit) const;
+};
+
+typedef BasicWireSet<int> WireSet;
+typedef BasicWireSet<long> WireSet64;
+
+#endif // !WIRESET_HPP
@@ -3,6 +3,7 @@
 #include <array>
 
 #include "intcode.hpp"
+#include "topology.hpp"
 
 typedef std::pair<std::vector<int>, intcode::RunState> Amplifier;
 
@@ -79,20 +80,19 @@ bool is_valid_reloop_sequence(const std::array<unsigned int, 5>& sequence) {
 }
 
 /**
- * Run the given amplifier with the given phase and input signal, and return
- * the modified amplifier with its new state
+ * Run the given amplifier on only its phase setting, which every program does
+ * the same work for regardless of the signals that follow. The amplifier stops
+ * on its first signal read and can be copied and resumed from there for each
+ * sequence it appears in
  * 
- * @param amplifier amplifier to run sequence on
+ * @param amplifier amplifier to specialize
  * @param phase_setting initialization phase setting
- * @param input_signal input signal from previous amplifier
- * @returns state modified amplifier
+ * @returns amplifier waiting on its first input signal
  */
-Amplifier run_amplifier(Amplifier amplifier, int phase_setting, int input_signal) {
-    std::vector<int> inputs{phase_setting, input_signal};
-
+Amplifier specialize_amplifier(Amplifier amplifier, int phase_setting) {
     intcode::RunState program_state = intcode::run_program(
         amplifier.first, // opcodes
-        inputs, 
+        {phase_setting}, 
         amplifier.second // run state
     );
 
@@ -102,6 +102,23 @@ Amplifier run_amplifier(Amplifier amplifier, int phase_setting, int input_signal
     return amplifier;
 }
 
+/**
+ * Specialize an amplifier for each of 5 consecutive phase settings
+ * 
+ * @param amplifier amplifier to specialize
+ * @param first_phase lowest phase setting
+ * @returns amplifiers indexed by phase setting minus the lowest phase
+ */
+std::array<Amplifier, 5> specialize_phases(const Amplifier& amplifier, unsigned int first_phase) {
+    std::array<Amplifier, 5> specialized;
+
+    for(int i = 0; i < specialized.size(); i++) {
+        specialized[i] = specialize_amplifier(amplifier, first_phase + i);
+    }
+
+    return specialized;
+}
+
 /**
  * Run the given amplifier for a reloop cycle, execute from previous position
  * with new input signal
@@ -123,58 +140,13 @@ Amplifier run_reloop_amplifier(Amplifier amplifier, int input_signal) {
     return amplifier;
 }
 
-/**
- * Initialize a set of aplifiers with a given phase sequence, this method runs 
- * in place and modifies the amplifies directly
- * 
- * @param amps a 5 length array of amplifiers
- * @param phases phase numbers to feed to corresponding amps
- * @return output from last amplifier
- */
-int init_amplifiers(std::array<Amplifier, 5>& amps, std::array<unsigned int, 5> phases) {
-    int previous_output = 0;
-
-    for(int i = 0; i < amps.size(); i++) {
-        Amplifier current_amp = run_amplifier(amps[i], phases[i], previous_output);
-        previous_output = current_amp.second.output[0];
-        amps[i] = current_amp;
-    }
-
-    return previous_output;
-}
-
-/**
- * Get the total reloop value of a set of amps on a given phase sequence
- * 
- * @param amps list of 5 amplifiers 
- * @param phases phase sequence to use for amplifier initialization
- * @returns final output value from last amplifier
- */
-int get_reloop_value(std::array<Amplifier, 5> amps, std::array<unsigned int, 5> phases) {
-    int previous_output = init_amplifiers(amps, phases);
-
-    // exit when the last amplifier has an exit condition of program end, 
-    // if the last amp returns input empty then it is signaling to loop again
-    while(amps.back().second.interrupt_reason != intcode::PROGRAM_FINISH) {
-
-        // reloop all amps with output of last run
-        for(int i = 0; i < amps.size(); i++) {
-            Amplifier current_amp = run_reloop_amplifier(amps[i], previous_output);
-            previous_output = current_amp.second.output.back();
-            amps[i] = current_amp;
-        }
-
-    }
-
-    return previous_output;
-}
-
 /**
  * Find the maximum phase sequence and output the result to stdout
  * 
  * @param amplifiers a list of 5 amplifiers to run test on
  */
 void do_max_sequence_test(const std::array<Amplifier, 5>& amplifiers) {
+    const std::array<Amplifier, 5> specialized = specialize_phases(amplifiers[0], 0);
     std::array<unsigned int, 5> max_setting;
     int max_setting_output = 0;
     
@@ -187,7 +159,7 @@ void do_max_sequence_test(const std::array<Amplifier, 5>& amplifiers) {
         // feed amps into each other to get final output
         int previous_output = 0;
         for(int i = 0; i < amplifiers.size(); i++) {
-            Amplifier current_amp = run_amplifier(amplifiers[i], phase_settings[i], previous_output);
+            Amplifier current_amp = run_reloop_amplifier(specialized[phase_settings[i]], previous_output);
             previous_output = current_amp.second.output[0];
         }
 
@@ -207,9 +179,10 @@ void do_max_sequence_test(const std::array<Amplifier, 5>& amplifiers) {
 /**
  * Find the maximum reloop sequence and output the result to stdout
  * 
- * @param amplifiers a list of 5 amplifiers to run test on
+ * @param loop topology of the amplifier feedback loop, taking the phase 
+ * settings as parameters
  */
-void do_max_reloop_test(const std::array<Amplifier, 5> amplifiers) {
+void do_max_reloop_test(const intcode::Topology& loop) {
     std::array<unsigned int, 5> max_reloop_setting; 
     int max_reloop_output = 0;
 
@@ -218,7 +191,9 @@ void do_max_reloop_test(const std::array<Amplifier, 5> amplifiers) {
         std::array<unsigned int, 5> phase_settings = get_reloop_sequence(i);
         if(!is_valid_reloop_sequence(phase_settings)) continue;
 
-        int current_reloop = get_reloop_value(amplifiers, phase_settings);
+        // the final signal is the last output of the last amplifier
+        intcode::Network network(loop, std::vector<int>(phase_settings.begin(), phase_settings.end()));
+        int current_reloop = network.run().back();
 
         if(current_reloop > max_reloop_output) {
             max_reloop_output = current_reloop;
@@ -235,6 +210,7 @@ void do_max_reloop_test(const std::array<Amplifier, 5> amplifiers) {
 }
 
 #define INPUT_LOCATION "./input"
+#define LOOP_TOPOLOGY_LOCATION "./loop.topology"
 
 int main(int argc, char** argv) {
 
@@ -252,7 +228,7 @@ int main(int argc, char** argv) {
     // part 1
     do_max_sequence_test(amplifiers);
     // part 2
-    do_max_reloop_test(amplifiers);
+    do_max_reloop_test(intcode::load_topology(LOOP_TOPOLOGY_LOCATION));
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include <cerrno>
+#include <climits>
+#include <thread>
+
+#include "topology.hpp"
+
+namespace intcode {
+
+/**
+ * Print an error for the given topology file line and exit
+ */
+static void topology_error(const std::string& file_location, int line, const std::string& message) {
+    std::cout << file_location << ":" << line << ": " << message << std::endl;
+    exit(-1);
+}
+
+/**
+ * Returns if text is a whole decimal number which fits in an int
+ */
+static bool is_int(const std::string& text) {
+    if(text.empty()) return false;
+
+    errno = 0;
+    char* end;
+    long value = strtol(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0 && value >= INT_MIN && value <= INT_MAX;
+}
+
+/**
+ * Get the index of the machine with the given name
+ *
+ * @param name machine name
+ * @returns index, -1 if there is no such machine
+ */
+int Topology::find_machine(const std::string& name) const {
+    for(size_t i = 0; i < machines.size(); i++) {
+        if(machines[i].name == name) return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Read a topology file, loading every program it names.
+ *
+ * Exits program with error message if the file or a program cannot be read
+ * or a line is not understood.
+ *
+ * @param file_location location of topology file
+ * @returns topology
+ */
+Topology load_topology(std::string file_location) {
+    std::ifstream input(file_location);
+
+    if(!input.is_open()) {
+        std::cout << "Unable to open topology file '" << file_location << "'" << std::endl;
+        exit(-1);
+    }
+
+    Topology topology;
+    std::string line;
+    int line_number = 0;
+
+    while(std::getline(input, line)) {
+        line_number++;
+
+        size_t comment = line.find('#');
+        if(comment != std::string::npos) line.erase(comment);
+
+        std::stringstream words(line);
+        std::string keyword;
+        if(!(words >> keyword)) continue;
+
+        if(keyword == "machine") {
+            MachineSpec machine;
+            machine.collect = false;
+
+            if(!(words >> machine.name >> machine.program)) {
+                topology_error(file_location, line_number, "machine needs a name and a program");
+            }
+            if(topology.find_machine(machine.name) >= 0) {
+                topology_error(file_location, line_number, "machine '" + machine.name + "' declared twice");
+            }
+
+            std::string value;
+            while(words >> value) {
+                bool parameter = value[0] == '$';
+                std::string number = parameter ? value.substr(1) : value;
+                if(parameter && !(number.size() > 0 && number[0] >= '0' && number[0] <= '9')) number.clear();
+                if(!is_int(number)) {
+                    topology_error(file_location, line_number, "input '" + value + "' is not a number or a parameter");
+                }
+                machine.inputs.push_back(value);
+            }
+
+            if(topology.programs.find(machine.program) == topology.programs.end()) {
+                std::ifstream test(machine.program);
+                if(!test.is_open()) {
+                    topology_error(file_location, line_number, "unable to open program '" + machine.program + "'");
+                }
+                topology.programs[machine.program] = get_opcodes_from_file(machine.program);
+            }
+
+            topology.machines.push_back(machine);
+        } else if(keyword == "edge" || keyword == "output") {
+            std::vector<int> named;
+            std::string name;
+            while(words >> name) {
+                int machine = topology.find_machine(name);
+                if(machine < 0) topology_error(file_location, line_number, "unknown machine '" + name + "'");
+                named.push_back(machine);
+            }
+
+            if(keyword == "output") {
+                for(int machine : named) topology.machines[machine].collect = true;
+            } else {
+                if(named.size() < 2) topology_error(file_location, line_number, "edge needs a source and a target");
+                // every target after the source is a fan out
+                for(size_t i = 1; i < named.size(); i++) topology.edges.push_back({ (size_t)named[0], (size_t)named[i] });
+            }
+        } else {
+            topology_error(file_location, line_number, "unknown declaration '" + keyword + "'");
+        }
+    }
+
+    return topology;
+}
+
+/**
+ * Instantiate a topology, filling in $n inputs from the given parameters.
+ * Inputs are checked when the topology is loaded
+ *
+ * @param topology topology to run
+ * @param parameters values for $0, $1, ...
+ * @param max_threads most threads to run on, 0 to use every hardware thread
+ */
+Network::Network(const Topology& topology, const std::vector<int>& parameters, size_t max_threads) :
+    idle_threads(0), quiescent(false) {
+
+    nodes.resize(topology.machines.size());
+
+    for(size_t i = 0; i < nodes.size(); i++) {
+        const MachineSpec& machine = topology.machines[i];
+        NetworkNode& node = nodes[i];
+
+        node.tape = topology.programs.at(machine.program);
+        node.collect = machine.collect;
+        node.finished = false;
+
+        for(const std::string& value : machine.inputs) {
+            if(value[0] != '$') {
+                node.pending.push_back(std::stoi(value));
+                continue;
+            }
+
+            size_t parameter = std::stoul(value.substr(1));
+            if(parameter >= parameters.size()) {
+                std::cout << "Missing parameter " << value << " for machine '" << machine.name << "'" << std::endl;
+                exit(-1);
+            }
+            node.pending.push_back(parameters[parameter]);
+        }
+    }
+
+    for(const EdgeSpec& edge : topology.edges) nodes[edge.from].targets.push_back(edge.to);
+
+    if(max_threads == 0) max_threads = std::max(1U, std::thread::hardware_concurrency());
+    place(max_threads);
+}
+
+/**
+ * Group machines which are in a cycle together or form a chain, then hand
+ * out the groups to threads, largest first to the least loaded thread
+ *
+ * @param max_threads most threads to use
+ */
+void Network::place(size_t max_threads) {
+    const size_t count = nodes.size();
+
+    // reaches[a][b] if b can be reached from a
+    std::vector<std::vector<bool>> reaches(count, std::vector<bool>(count, false));
+    for(size_t start = 0; start < count; start++) {
+        std::vector<size_t> stack{start};
+        while(!stack.empty()) {
+            size_t current = stack.back();
+            stack.pop_back();
+            for(size_t target : nodes[current].targets) {
+                if(reaches[start][target]) continue;
+                reaches[start][target] = true;
+                stack.push_back(target);
+            }
+        }
+    }
+
+    std::vector<size_t> parent(count);
+    for(size_t i = 0; i < count; i++) parent[i] = i;
+
+    auto find = [&](size_t machine) {
+        while(parent[machine] != machine) machine = parent[machine] = parent[parent[machine]];
+        return machine;
+    };
+    auto join = [&](size_t a, size_t b) { parent[find(a)] = find(b); };
+
+    std::vector<size_t> in_degree(count, 0);
+    for(auto& node : nodes) {
+        for(size_t target : node.targets) in_degree[target]++;
+    }
+
+    for(size_t a = 0; a < count; a++) {
+        for(size_t b = a + 1; b < count; b++) {
+            if(reaches[a][b] && reaches[b][a]) join(a, b);
+        }
+        for(size_t target : nodes[a].targets) {
+            if(nodes[a].targets.size() == 1 && in_degree[target] == 1) join(a, target);
+        }
+    }
+
+    std::map<size_t, std::vector<size_t>> groups;
+    for(size_t i = 0; i < count; i++) groups[find(i)].push_back(i);
+
+    std::vector<std::vector<size_t>> ordered;
+    for(auto& group : groups) ordered.push_back(group.second);
+    std::stable_sort(ordered.begin(), ordered.end(),
+        [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.size() > b.size(); });
+
+    threads.assign(std::min(max_threads, ordered.size()), {});
+    for(auto& group : ordered) {
+        size_t thread = 0;
+        for(size_t i = 1; i < threads.size(); i++) {
+            if(threads[i].size() < threads[thread].size()) thread = i;
+        }
+
+        for(size_t machine : group) {
+            threads[thread].push_back(machine);
+            nodes[machine].thread = thread;
+        }
+    }
+
+    for(auto& thread : threads) std::sort(thread.begin(), thread.end());
+}
+
+/**
+ * Run a machine on everything queued for it and pass its output on
+ *
+ * @param node machine to run
+ * @returns true if the machine ran
+ */
+bool Network::run_node(NetworkNode& node) {
+    if(node.finished) {
+        node.pending.clear();
+        return false;
+    }
+    if(node.state.interrupt_reason != PROGRAM_BEGIN && node.pending.empty()) return false;
+
+    std::vector<int> input;
+    input.swap(node.pending);
+    node.state = run_program(node.tape, input, node.state);
+    node.finished = node.state.interrupt_reason != INPUT_EMPTY;
+
+    // output is handed on right away, so run state never carries it
+    std::vector<int> output;
+    output.swap(node.state.output);
+    if(output.empty()) return true;
+
+    if(node.collect) node.collected.insert(node.collected.end(), output.begin(), output.end());
+
+    for(size_t target : node.targets) {
+        NetworkNode& next = nodes[target];
+
+        if(next.thread == node.thread) {
+            next.pending.insert(next.pending.end(), output.begin(), output.end());
+        } else {
+            std::lock_guard<std::mutex> guard(lock);
+            next.inbox.insert(next.inbox.end(), output.begin(), output.end());
+            woken.notify_all();
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Returns if nothing is waiting to cross threads, called with the lock held
+ */
+bool Network::inboxes_empty(void) const {
+    for(auto& node : nodes) {
+        if(!node.inbox.empty()) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Run the machines placed on a thread until the whole network is quiescent,
+ * every thread idle with nothing in flight
+ *
+ * @param thread thread index
+ */
+void Network::run_thread(size_t thread) {
+    const std::vector<size_t>& machines = threads[thread];
+
+    while(true) {
+        // run machines on this thread until none of them can make progress
+        bool progressed = true;
+        while(progressed) {
+            progressed = false;
+            for(size_t machine : machines) progressed |= run_node(nodes[machine]);
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        while(true) {
+            bool received = false;
+            for(size_t machine : machines) {
+                NetworkNode& node = nodes[machine];
+                if(node.inbox.empty()) continue;
+
+                node.pending.insert(node.pending.end(), node.inbox.begin(), node.inbox.end());
+                node.inbox.clear();
+                received = true;
+            }
+            if(received) break;
+            if(quiescent) return;
+
+            idle_threads++;
+            if(idle_threads == threads.size() && inboxes_empty()) {
+                quiescent = true;
+                woken.notify_all();
+                return;
+            }
+
+            woken.wait(guard);
+            idle_threads--;
+        }
+    }
+}
+
+/**
+ * Run the network to quiescence, the calling thread runs the first group of
+ * machines
+ *
+ * @returns output of every machine named as an output, in declaration order
+ */
+std::vector<int> Network::run(void) {
+    std::vector<int> result;
+    if(threads.empty()) return result;
+
+    idle_threads = 0;
+    quiescent = false;
+
+    std::vector<std::thread> workers;
+    for(size_t thread = 1; thread < threads.size(); thread++) {
+        workers.emplace_back(&Network::run_thread, this, thread);
+    }
+    run_thread(0);
+    for(auto& worker : workers) worker.join();
+
+    for(auto& node : nodes) {
+        if(node.collect) result.insert(result.end(), node.collected.begin(), node.collected.end());
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+#include "intcode.hpp"
+
+namespace intcode {
+
+    /**
+     * A machine as described in a topology file, inputs are either numbers
+     * or parameters ($0, $1, ...) filled in when the topology is run
+     */
+    class MachineSpec {
+    public:
+        std::string name;
+        std::string program;
+        std::vector<std::string> inputs;
+        // if this machine's output is part of the result
+        bool collect;
+    };
+
+    /**
+     * Every output of the source machine is also an input of the target
+     */
+    class EdgeSpec {
+    public:
+        size_t from, to;
+    };
+
+    /**
+     * Machines and the edges between them, read from a text file with one
+     * declaration per line and # starting a comment:
+     *
+     *     machine <name> <program file> [input ...]
+     *     edge <from> <to> [to ...]
+     *     output <name>
+     *
+     * A machine with several outgoing edges sends every output down all of
+     * them, a machine with several incoming edges reads them in the order
+     * they arrive
+     */
+    class Topology {
+    public:
+        std::vector<MachineSpec> machines;
+        std::vector<EdgeSpec> edges;
+        // programs by file location, each loaded once
+        std::map<std::string, std::vector<int>> programs;
+
+        int find_machine(const std::string& name) const;
+    };
+
+    Topology load_topology(std::string file_location);
+
+    /**
+     * A running machine, inputs for it are queued in its inbox by machines on
+     * other threads and in pending by machines on the same thread
+     */
+    class NetworkNode {
+    public:
+        std::vector<int> tape;
+        RunState state;
+        std::vector<int> inbox;
+        std::vector<int> pending;
+        std::vector<size_t> targets;
+        std::vector<int> collected;
+        size_t thread;
+        bool collect;
+        bool finished;
+    };
+
+    /**
+     * An instance of a topology, run until no machine can make progress.
+     *
+     * Machines are placed on threads by group. Machines which depend on each
+     * other in a cycle, or follow each other in a chain with no branching,
+     * spend most of their time waiting on one another and share a group, so
+     * values between them never cross threads. Groups are then spread over
+     * at most max_threads threads
+     */
+    class Network {
+    public:
+        std::vector<NetworkNode> nodes;
+        // machines placed on each thread
+        std::vector<std::vector<size_t>> threads;
+
+        Network(const Topology& topology, const std::vector<int>& parameters = {},
+            size_t max_threads = 0);
+
+        std::vector<int> run(void);
+
+    private:
+        std::mutex lock;
+        std::condition_variable woken;
+        size_t idle_threads;
+        bool quiescent;
+
+        void place(size_t max_threads);
+        void run_thread(size_t thread);
+        bool run_node(NetworkNode& node);
+        bool inboxes_empty(void) const;
+    };
+
+}
+
+#endif // !TOPOLOGY_HPP
@@ -0,0 +1,478 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+
+#include "intcode.hpp"
+#include "engine.hpp"
+#include "ir.hpp"
+#include "closure.hpp"
+#include "cluster.hpp"
+
+/* Microbenchmarks for the Intcode engines, run with `make bench` */
+
+static std::atomic<unsigned long> allocation_count(0);
+
+// kept out of line, once inlined gcc sees malloc() on one side and free()
+// or operator delete on the other and warns about a mismatched pair
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocation_count++;
+    void* memory = malloc(size == 0 ? 1 : size);
+    if(memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// benchmarks keep running until they have taken at least this long
+const double MIN_SECONDS = 0.25;
+
+/**
+ * Result of a single benchmark, all per iteration values are averages
+ */
+class BenchmarkResult {
+public:
+    std::string name;
+    unsigned long iterations;
+    double seconds;
+    // Intcode instructions (or operations for micro benchmarks) per iteration
+    unsigned long operations;
+    unsigned long allocations;
+
+    double get_nanoseconds_per_iteration(void) const {
+        return seconds * 1e9 / iterations;
+    }
+
+    double get_operations_per_second(void) const {
+        return (double)operations * iterations / seconds;
+    }
+};
+
+/**
+ * Run a benchmark body repeatedly, doubling the iteration count until it
+ * runs for at least MIN_SECONDS, the body returns how many operations a
+ * single iteration performed
+ *
+ * @param name benchmark name
+ * @param body benchmark body
+ * @returns timing result
+ */
+BenchmarkResult run_benchmark(std::string name, std::function<unsigned long(void)> body) {
+    // warm up caches and any lazily built state
+    unsigned long operations = body();
+
+    unsigned long iterations = 1;
+    while(true) {
+        unsigned long allocations_before = allocation_count;
+        auto start = std::chrono::steady_clock::now();
+
+        for(unsigned long i = 0; i < iterations; i++) operations = body();
+
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        if(seconds >= MIN_SECONDS || iterations >= (1UL << 30)) {
+            BenchmarkResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.seconds = seconds;
+            result.operations = operations;
+            result.allocations = (allocation_count - allocations_before) / iterations;
+            return result;
+        }
+
+        iterations *= 2;
+    }
+}
+
+/**
+ * Amount of instructions a program executes for the given input, used to
+ * turn baseline run times into instructions per second
+ *
+ * @param program program tape
+ * @param input program input
+ * @returns instructions executed
+ */
+unsigned long count_instructions(std::vector<long> program, std::vector<long> input) {
+    intcode::Engine engine(program, false);
+    engine.push_input(input);
+    engine.run();
+
+    return engine.steps;
+}
+
+/**
+ * Run a program to completion on the baseline interpreter
+ */
+std::vector<long> run_baseline(const std::vector<long>& program, std::vector<long> input) {
+    std::vector<long> tape = program;
+    return intcode::run_program(tape, input).output;
+}
+
+/**
+ * Run a program to completion on the decode cache engine
+ */
+std::vector<long> run_engine(const std::vector<long>& program, std::vector<long> input,
+    unsigned long* steps = nullptr) {
+
+    std::vector<long> tape = program;
+    intcode::Engine engine(tape);
+    engine.push_input(input);
+    engine.run();
+
+    if(steps != nullptr) *steps += engine.steps;
+
+    return engine.output;
+}
+
+/**
+ * Run a program to completion through one of the block runners on top of
+ * the engine, IRRunner or ClosureRunner
+ */
+template<class RUNNER>
+std::vector<long> run_blocks(const std::vector<long>& program, std::vector<long> input) {
+    std::vector<long> tape = program;
+    intcode::Engine engine(tape);
+    engine.push_input(input);
+    RUNNER runner(engine);
+    runner.run();
+
+    return engine.output;
+}
+
+/**
+ * Day 7 part 1, feed every permutation of phases 0-4 through a chain of 5
+ * amplifiers and return the highest signal
+ */
+long run_amplifier_chain(const std::vector<long>& program, bool use_engine, unsigned long* steps) {
+    std::array<long, 5> phases{0, 1, 2, 3, 4};
+    long best = 0;
+
+    do {
+        long signal = 0;
+        for(long phase : phases) {
+            std::vector<long> output = use_engine ?
+                run_engine(program, {phase, signal}, steps) : run_baseline(program, {phase, signal});
+            signal = output.back();
+        }
+        best = std::max(best, signal);
+    } while(std::next_permutation(phases.begin(), phases.end()));
+
+    return best;
+}
+
+/**
+ * Day 7 part 2, feed every permutation of phases 5-9 through a feedback loop
+ * of 5 amplifiers and return the highest signal
+ */
+long run_amplifier_loop(const std::vector<long>& program, bool use_engine, unsigned long* steps) {
+    std::array<long, 5> phases{5, 6, 7, 8, 9};
+    long best = 0;
+
+    do {
+        long signal = 0;
+
+        if(use_engine) {
+            std::array<std::vector<long>, 5> tapes;
+            std::vector<intcode::Engine> amps;
+            amps.reserve(5);
+            for(int i = 0; i < 5; i++) {
+                tapes[i] = program;
+                amps.emplace_back(tapes[i]);
+                amps[i].push_input({phases[i]});
+            }
+
+            bool finished = false;
+            while(!finished) {
+                for(auto& amp : amps) {
+                    amp.push_input({signal});
+                    finished = amp.run() == intcode::PROGRAM_FINISH;
+                    signal = amp.output.back();
+                }
+            }
+
+            for(auto& amp : amps) *steps += amp.steps;
+        } else {
+            std::array<std::vector<long>, 5> tapes;
+            std::array<intcode::RunState, 5> states;
+            for(int i = 0; i < 5; i++) tapes[i] = program;
+
+            bool first = true;
+            while(states[4].interrupt_reason != intcode::PROGRAM_FINISH) {
+                for(int i = 0; i < 5; i++) {
+                    std::vector<long> input = first ? std::vector<long>{phases[i], signal} : std::vector<long>{signal};
+                    states[i] = intcode::run_program(tapes[i], input, states[i]);
+                    signal = states[i].output.back();
+                }
+                first = false;
+            }
+        }
+
+        best = std::max(best, signal);
+    } while(std::next_permutation(phases.begin(), phases.end()));
+
+    return best;
+}
+
+/**
+ * Counting loop using address mode, 2 instructions per iteration
+ */
+std::vector<long> make_address_loop(long count) {
+    return {
+        1101, 0, count, 100,    // [100] = count
+        1001, 100, -1, 100,     // [100] -= 1
+        1005, 100, 4,           // loop while [100] != 0
+        4, 100,
+        99
+    };
+}
+
+/**
+ * Counting loop using relative mode, 2 instructions per iteration
+ */
+std::vector<long> make_relative_loop(long count) {
+    return {
+        109, 200,               // base = 200
+        21101, 0, count, 0,     // [base] = count
+        21201, 0, -1, 0,        // [base] -= 1
+        1205, 0, 6,             // loop while [base] != 0
+        204, 0,
+        99
+    };
+}
+
+/**
+ * Program which echoes every input value back as output, `count` times
+ */
+std::vector<long> make_echo_program(long count) {
+    return {
+        1101, 0, count, 100,    // [100] = count
+        3, 101,                 // [101] = input
+        4, 101,                 // output [101]
+        1001, 100, -1, 100,     // [100] -= 1
+        1005, 100, 4,           // loop while [100] != 0
+        99
+    };
+}
+
+/**
+ * Cluster node passing a packet around a ring of `size` nodes, every hop adds
+ * 1 to y and after `hops` hops the packet goes to address `size` instead,
+ * which has no node behind it
+ */
+std::vector<long> make_ring_node(long size, long hops) {
+    return {
+        3, 100,                 // [100] = address
+        1008, 100, 0, 103,      // [103] = address == 0
+        1006, 103, 15,          // only node 0 sends the first packet
+        104, 1, 104, 0, 104, 0, // send (1, 0, 0)
+        3, 101,                 // [101] = x
+        3, 102,                 // [102] = y
+        1001, 102, 1, 102,      // [102] += 1
+        1007, 102, hops, 103,   // [103] = y < hops
+        1005, 103, 39,          // forward while under the hop count
+        104, size, 4, 101, 4, 102, // send (size, x, y)
+        1105, 1, 15,
+        1001, 100, 1, 104,      // [104] = address + 1
+        1008, 104, size, 103,   // [103] = [104] == size
+        1006, 103, 54,
+        1101, 0, 0, 104,        // wrap around to node 0
+        4, 104, 4, 101, 4, 102, // send ([104], x, y)
+        1105, 1, 15
+    };
+}
+
+bool load_program(std::string file_location, std::vector<long>& program) {
+    std::ifstream test(file_location);
+    if(!test.is_open()) {
+        std::cerr << "skipping benchmarks for missing input '" << file_location << "'" << std::endl;
+        return false;
+    }
+    program = intcode::get_opcodes_from_file(file_location);
+    return true;
+}
+
+void print_table(const std::vector<BenchmarkResult>& results) {
+    printf("%-36s %12s %14s %16s %10s\n", "BENCHMARK", "ITERATIONS", "NS/ITER", "OPS/SEC", "ALLOCS");
+    for(auto& result : results) {
+        printf("%-36s %12lu %14.0f %16.0f %10lu\n", result.name.c_str(), result.iterations,
+            result.get_nanoseconds_per_iteration(), result.get_operations_per_second(),
+            result.allocations);
+    }
+}
+
+void print_json(const std::vector<BenchmarkResult>& results) {
+    printf("{\n  \"benchmarks\": [\n");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        printf("    {\"name\": \"%s\", \"iterations\": %lu, \"real_time_ns\": %.1f, "
+            "\"items_per_second\": %.1f, \"allocations_per_iteration\": %lu}%s\n",
+            result.name.c_str(), result.iterations, result.get_nanoseconds_per_iteration(),
+            result.get_operations_per_second(), result.allocations,
+            (i + 1 < results.size()) ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    std::string filter;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--json") == 0) json = true;
+        else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+    }
+
+    std::vector<BenchmarkResult> results;
+    auto add = [&](std::string name, std::function<unsigned long(void)> body) {
+        if(!filter.empty() && name.find(filter) == std::string::npos) return;
+        results.push_back(run_benchmark(name, body));
+    };
+
+    std::vector<long> boost;
+    bool have_boost = load_program("./input", boost);
+
+    /* decode */
+    if(have_boost) {
+        add("decode/parse_instruction", [&]() {
+            long sum = 0;
+            for(long value : boost) sum += intcode::parse_instruction(value > 0 ? value % 100000 : 0).opcode;
+            asm volatile("" : : "r"(sum));
+            return (unsigned long)boost.size();
+        });
+        add("decode/decode_instruction", [&]() {
+            long sum = 0;
+            for(size_t i = 0; i < boost.size(); i++) sum += intcode::decode_instruction(boost, i).opcode;
+            asm volatile("" : : "r"(sum));
+            return (unsigned long)boost.size();
+        });
+    }
+
+    /* operand fetch */
+    if(have_boost) {
+        std::vector<long> tape = boost;
+        intcode::Engine engine(tape);
+        engine.relative_base = 0;
+        for(int mode = 0; mode < 3; mode++) {
+            add("fetch/mode_" + std::to_string(mode), [&, mode]() {
+                long sum = 0;
+                for(size_t i = 0; i < tape.size(); i++) {
+                    long arg = (mode == intcode::MODE_IMMEDIATE) ? tape[i] : i;
+                    sum += engine.read(mode, arg);
+                }
+                asm volatile("" : : "r"(sum));
+                return (unsigned long)tape.size();
+            });
+        }
+    }
+
+    /* memory growth */
+    add("memory/engine_store_ascending", []() {
+        std::vector<long> tape(16, 0);
+        intcode::Engine engine(tape);
+        for(long i = 0; i < 100000; i++) engine.store(i, i);
+        return 100000UL;
+    });
+    add("memory/bundle_expand_ascending", []() {
+        std::vector<long> tape(16, 0);
+        std::vector<long> output;
+        intcode::NumberStream input({});
+        intcode::InstructionBundle bundle(0, tape, input, output);
+        for(long i = 0; i < 100000; i++) {
+            if(i >= (long)tape.size()) bundle.expand_memory(i + 1 - tape.size());
+            tape[i] = i;
+        }
+        return 100000UL;
+    });
+
+    /* i/o channel throughput */
+    add("io/number_stream", []() {
+        intcode::NumberStream stream({});
+        long sum = 0;
+        for(long i = 0; i < 100000; i++) stream.push(i);
+        while(stream.size() > 0) sum += stream.get();
+        asm volatile("" : : "r"(sum));
+        return 100000UL;
+    });
+    std::vector<long> echo = make_echo_program(10000);
+    std::vector<long> echo_input(10000, 7);
+    add("io/echo_baseline", [&]() { run_baseline(echo, echo_input); return 10000UL; });
+    add("io/echo_engine", [&]() { run_engine(echo, echo_input); return 10000UL; });
+
+    /* full programs, operations are Intcode instructions */
+    std::vector<long> program;
+    if(load_program("../day2/input", program)) {
+        unsigned long steps = count_instructions(program, {});
+        add("program/day2/baseline", [=]() { run_baseline(program, {}); return steps; });
+        add("program/day2/engine", [=]() { run_engine(program, {}); return steps; });
+    }
+    if(load_program("../day5/input", program)) {
+        for(long id : {1L, 5L}) {
+            unsigned long steps = count_instructions(program, {id});
+            std::string name = "program/day5_diagnostic_" + std::to_string(id);
+            add(name + "/baseline", [=]() { run_baseline(program, {id}); return steps; });
+            add(name + "/engine", [=]() { run_engine(program, {id}); return steps; });
+        }
+    }
+    if(load_program("../day7/input", program)) {
+        unsigned long chain_steps = 0, loop_steps = 0;
+        run_amplifier_chain(program, true, &chain_steps);
+        run_amplifier_loop(program, true, &loop_steps);
+
+        add("program/day7_part1/baseline", [=]() { run_amplifier_chain(program, false, nullptr); return chain_steps; });
+        add("program/day7_part1/engine", [=]() { unsigned long s = 0; run_amplifier_chain(program, true, &s); return s; });
+        add("program/day7_part2/baseline", [=]() { run_amplifier_loop(program, false, nullptr); return loop_steps; });
+        add("program/day7_part2/engine", [=]() { unsigned long s = 0; run_amplifier_loop(program, true, &s); return s; });
+    }
+    if(have_boost) {
+        unsigned long steps = count_instructions(boost, {2});
+        add("program/day9_boost/baseline", [&]() { run_baseline(boost, {2}); return steps; });
+        add("program/day9_boost/engine", [&]() { run_engine(boost, {2}); return steps; });
+        add("program/day9_boost/ir", [&]() { run_blocks<intcode::IRRunner>(boost, {2}); return steps; });
+        add("program/day9_boost/closure", [&]() { run_blocks<intcode::ClosureRunner>(boost, {2}); return steps; });
+    }
+
+    /* cluster, operations are packets routed */
+    for(long size : {50L, 500L}) {
+        std::vector<long> node = make_ring_node(size, 100000);
+        add("cluster/ring_" + std::to_string(size), [=]() {
+            intcode::Cluster cluster(node, size);
+            cluster.run();
+            return cluster.stats.packets;
+        });
+    }
+
+    std::vector<long> address_loop = make_address_loop(200000);
+    std::vector<long> relative_loop = make_relative_loop(200000);
+    unsigned long address_steps = count_instructions(address_loop, {});
+    unsigned long relative_steps = count_instructions(relative_loop, {});
+    add("program/loop_address/baseline", [&]() { run_baseline(address_loop, {}); return address_steps; });
+    add("program/loop_address/engine", [&]() { run_engine(address_loop, {}); return address_steps; });
+    add("program/loop_address/ir", [&]() { run_blocks<intcode::IRRunner>(address_loop, {}); return address_steps; });
+    add("program/loop_address/closure", [&]() {
+        run_blocks<intcode::ClosureRunner>(address_loop, {});
+        return address_steps;
+    });
+    add("program/loop_relative/baseline", [&]() { run_baseline(relative_loop, {}); return relative_steps; });
+    add("program/loop_relative/engine", [&]() { run_engine(relative_loop, {}); return relative_steps; });
+    add("program/loop_relative/ir", [&]() { run_blocks<intcode::IRRunner>(relative_loop, {}); return relative_steps; });
+    add("program/loop_relative/closure", [&]() {
+        run_blocks<intcode::ClosureRunner>(relative_loop, {});
+        return relative_steps;
+    });
+
+    if(json) print_json(results);
+    else print_table(results);
+
+    return 0;
+}
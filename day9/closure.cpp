@@ -0,0 +1,421 @@
+#include <cstdio>
+
+#include "closure.hpp"
+
+namespace intcode {
+
+const int NO_CLOSURE_BLOCK = -1;
+const int CLOSURE_NOT_COMPILABLE = -2;
+
+/** ############### **/
+/** BEGIN HANDLERS  **/
+/** ############### **/
+
+template<int KIND>
+static inline long fetch(const ClosureOp& op, int operand, const Engine& engine) {
+    switch(KIND) {
+        case READ_IMMEDIATE: return op.args[operand];
+        case READ_POINTER: return *op.pointers[operand];
+        default: return engine.load(engine.relative_base + op.args[operand]);
+    }
+}
+
+template<int KIND>
+static inline bool put(const ClosureOp& op, ClosureRunner& runner, long value) {
+    Engine& engine = runner.engine;
+
+    switch(KIND) {
+        case WRITE_POINTER:
+            if(engine.cache.is_code(op.args[2])) return runner.store_slow(op, op.args[2], value);
+            *op.pointers[2] = value;
+            return true;
+        case WRITE_RELATIVE: {
+            long location = engine.relative_base + op.args[2];
+            if(location < 0 || location >= (long)engine.tape.size() || engine.cache.is_code(location)) {
+                return runner.store_slow(op, location, value);
+            }
+            engine.tape[location] = value;
+            return true;
+        }
+        default:
+            return runner.store_slow(op, op.args[2], value);
+    }
+}
+
+template<unsigned int OPCODE, int LEFT, int RIGHT, int WRITE>
+static bool handle_arithmetic(const ClosureOp& op, ClosureRunner& runner) {
+    long left = fetch<LEFT>(op, 0, runner.engine);
+    long right = fetch<RIGHT>(op, 1, runner.engine);
+
+    switch(OPCODE) {
+        case OP_ADD: return put<WRITE>(op, runner, left + right);
+        case OP_MULTI: return put<WRITE>(op, runner, left * right);
+        case OP_LESS_THAN: return put<WRITE>(op, runner, left < right);
+        default: return put<WRITE>(op, runner, left == right);
+    }
+}
+
+template<bool ON_TRUE, int TEST, int TARGET>
+static bool handle_jump(const ClosureOp& op, ClosureRunner& runner) {
+    Engine& engine = runner.engine;
+
+    if((fetch<TEST>(op, 0, engine) != 0) == ON_TRUE) {
+        long location = fetch<TARGET>(op, 1, engine);
+        if(location < 0) {
+            throw std::runtime_error("Attempted to jump to out of bounds address " + std::to_string(location));
+        }
+        engine.position = location;
+    } else {
+        engine.position = op.next;
+    }
+
+    return false;
+}
+
+template<int VALUE>
+static bool handle_output(const ClosureOp& op, ClosureRunner& runner) {
+    runner.engine.output.push_back(fetch<VALUE>(op, 0, runner.engine));
+    return true;
+}
+
+template<int VALUE>
+static bool handle_adjust_base(const ClosureOp& op, ClosureRunner& runner) {
+    runner.engine.relative_base += fetch<VALUE>(op, 0, runner.engine);
+    return true;
+}
+
+/** ############# **/
+/** END HANDLERS  **/
+/** ############# **/
+
+// pick the instantiation for operand kinds only known at run time, one
+// operand at a time
+
+template<unsigned int OPCODE, int LEFT, int RIGHT>
+static ClosureHandler pick_write(int write) {
+    switch(write) {
+        case WRITE_POINTER: return &handle_arithmetic<OPCODE, LEFT, RIGHT, WRITE_POINTER>;
+        case WRITE_RELATIVE: return &handle_arithmetic<OPCODE, LEFT, RIGHT, WRITE_RELATIVE>;
+        default: return &handle_arithmetic<OPCODE, LEFT, RIGHT, WRITE_FAR>;
+    }
+}
+
+template<unsigned int OPCODE, int LEFT>
+static ClosureHandler pick_right(int right, int write) {
+    switch(right) {
+        case READ_IMMEDIATE: return pick_write<OPCODE, LEFT, READ_IMMEDIATE>(write);
+        case READ_POINTER: return pick_write<OPCODE, LEFT, READ_POINTER>(write);
+        default: return pick_write<OPCODE, LEFT, READ_RELATIVE>(write);
+    }
+}
+
+template<unsigned int OPCODE>
+static ClosureHandler pick_left(int left, int right, int write) {
+    switch(left) {
+        case READ_IMMEDIATE: return pick_right<OPCODE, READ_IMMEDIATE>(right, write);
+        case READ_POINTER: return pick_right<OPCODE, READ_POINTER>(right, write);
+        default: return pick_right<OPCODE, READ_RELATIVE>(right, write);
+    }
+}
+
+template<bool ON_TRUE, int TEST>
+static ClosureHandler pick_target(int target) {
+    switch(target) {
+        case READ_IMMEDIATE: return &handle_jump<ON_TRUE, TEST, READ_IMMEDIATE>;
+        case READ_POINTER: return &handle_jump<ON_TRUE, TEST, READ_POINTER>;
+        default: return &handle_jump<ON_TRUE, TEST, READ_RELATIVE>;
+    }
+}
+
+template<bool ON_TRUE>
+static ClosureHandler pick_test(int test, int target) {
+    switch(test) {
+        case READ_IMMEDIATE: return pick_target<ON_TRUE, READ_IMMEDIATE>(target);
+        case READ_POINTER: return pick_target<ON_TRUE, READ_POINTER>(target);
+        default: return pick_target<ON_TRUE, READ_RELATIVE>(target);
+    }
+}
+
+template<template<int> class HANDLER>
+static ClosureHandler pick_single(int kind) {
+    switch(kind) {
+        case READ_IMMEDIATE: return &HANDLER<READ_IMMEDIATE>::handle;
+        case READ_POINTER: return &HANDLER<READ_POINTER>::handle;
+        default: return &HANDLER<READ_RELATIVE>::handle;
+    }
+}
+
+template<int VALUE>
+class OutputHandler {
+public:
+    static bool handle(const ClosureOp& op, ClosureRunner& runner) { return handle_output<VALUE>(op, runner); }
+};
+
+template<int VALUE>
+class AdjustBaseHandler {
+public:
+    static bool handle(const ClosureOp& op, ClosureRunner& runner) { return handle_adjust_base<VALUE>(op, runner); }
+};
+
+/**
+ * Get the handler for an instruction given the kinds of its operands
+ *
+ * @param opcode real opcode
+ * @param kinds read kinds of the operands, for arithmetic the third is the
+ * write kind
+ * @returns handler
+ */
+static ClosureHandler get_handler(unsigned int opcode, const int kinds[3]) {
+    switch(opcode) {
+        case OP_ADD: return pick_left<OP_ADD>(kinds[0], kinds[1], kinds[2]);
+        case OP_MULTI: return pick_left<OP_MULTI>(kinds[0], kinds[1], kinds[2]);
+        case OP_LESS_THAN: return pick_left<OP_LESS_THAN>(kinds[0], kinds[1], kinds[2]);
+        case OP_EQUALS: return pick_left<OP_EQUALS>(kinds[0], kinds[1], kinds[2]);
+        case OP_JUMP_TRUE: return pick_test<true>(kinds[0], kinds[1]);
+        case OP_JUMP_FALSE: return pick_test<false>(kinds[0], kinds[1]);
+        case OP_OUTPUT: return pick_single<OutputHandler>(kinds[0]);
+        default: return pick_single<AdjustBaseHandler>(kinds[0]);
+    }
+}
+
+ClosureRunner::ClosureRunner(Engine& engine) : engine(engine), tape_data(engine.tape.data()),
+    tape_size(engine.tape.size()), generation(engine.cache.generation), zero(0) {}
+
+ClosureRunner::~ClosureRunner() {
+    clear();
+}
+
+/**
+ * Returns if the blocks were built against a tape or code which has since
+ * changed
+ */
+bool ClosureRunner::is_stale(void) const {
+    return engine.tape.data() != tape_data || engine.tape.size() != tape_size ||
+        engine.cache.generation != generation;
+}
+
+/**
+ * Store through the engine for writes which may land in code or grow the
+ * tape, if either happens the block stops right after the instruction
+ *
+ * @param op instruction doing the store
+ * @param location tape address
+ * @param value value to write
+ * @returns false if the block has to stop
+ */
+bool ClosureRunner::store_slow(const ClosureOp& op, long location, long value) {
+    engine.store(location, value);
+    if(!is_stale()) return true;
+
+    engine.position = op.next;
+    engine.steps += op.retired;
+    stats.retired += op.retired;
+
+    return false;
+}
+
+/**
+ * Bind every instruction of the block starting at the given position to its
+ * handler, resolving address mode operands to tape pointers
+ *
+ * @param position first instruction
+ * @returns block index, CLOSURE_NOT_COMPILABLE if the block would be empty
+ */
+int ClosureRunner::compile(long position) {
+    std::vector<long>& tape = engine.tape;
+
+    ClosureBlock block;
+    block.position = position;
+    block.end = position;
+    block.ends_in_jump = false;
+    block.valid = true;
+
+    while(block.end < (long)tape.size() && (int)block.ops.size() < MAX_CLOSURE_OPS) {
+        DecodedInstruction instruction = decode_instruction(tape, block.end);
+        unsigned int opcode = instruction.opcode;
+        int operands = get_operand_count(opcode);
+
+        if(opcode == OP_INPUT || operands == 0) break;
+
+        bool arithmetic = operands == 3;
+        int kinds[3] = { 0, 0, 0 };
+        bool bindable = true;
+
+        ClosureOp op = {};
+        for(int i = 0; i < operands; i++) {
+            int mode = instruction.modes[i];
+            long arg = instruction.args[i];
+            op.args[i] = arg;
+            op.pointers[i] = nullptr;
+
+            // negative addresses have to throw, leave them to the engine, an
+            // immediate write operand is an address too
+            bool address = mode == MODE_ADDRESS || (arithmetic && i == 2 && mode == MODE_IMMEDIATE);
+            if(mode > MODE_RELATIVE || (address && arg < 0)) bindable = false;
+            if(!bindable) break;
+
+            bool in_tape = arg < (long)tape.size();
+            if(arithmetic && i == 2) {
+                kinds[i] = (mode == MODE_RELATIVE) ? WRITE_RELATIVE : (in_tape ? WRITE_POINTER : WRITE_FAR);
+                if(kinds[i] == WRITE_POINTER) op.pointers[i] = &tape[arg];
+            } else if(mode == MODE_IMMEDIATE) {
+                kinds[i] = READ_IMMEDIATE;
+            } else if(mode == MODE_RELATIVE) {
+                kinds[i] = READ_RELATIVE;
+            } else {
+                kinds[i] = READ_POINTER;
+                op.pointers[i] = in_tape ? &tape[arg] : &zero;
+            }
+        }
+        if(!bindable) break;
+
+        block.end += instruction.length;
+        op.handler = get_handler(opcode, kinds);
+        op.next = block.end;
+        op.retired = block.ops.size() + 1;
+        block.ops.push_back(op);
+
+        if(opcode == OP_JUMP_TRUE || opcode == OP_JUMP_FALSE) {
+            block.ends_in_jump = true;
+            break;
+        }
+    }
+
+    if(block.ops.empty()) return CLOSURE_NOT_COMPILABLE;
+
+    if(block.end > (long)code_cells.size()) code_cells.resize(block.end, 0);
+    for(long i = block.position; i < block.end; i++) {
+        if(code_cells[i]++ == 0) engine.cache.cover(i, i + 1, 1);
+    }
+
+    stats.blocks++;
+    blocks.push_back(block);
+
+    return blocks.size() - 1;
+}
+
+/**
+ * Find or build the block starting at the given position
+ *
+ * @returns block index, negative if the engine has to run it
+ */
+int ClosureRunner::get_block(long position) {
+    if(position < 0 || position >= (long)engine.tape.size()) return NO_CLOSURE_BLOCK;
+    if(position >= (long)block_at.size()) block_at.resize(engine.tape.size(), NO_CLOSURE_BLOCK);
+
+    int index = block_at[position];
+    if(index == NO_CLOSURE_BLOCK) {
+        index = compile(position);
+        block_at[position] = index;
+    }
+
+    return index;
+}
+
+/**
+ * Throw away every block, they are built again against the current tape
+ */
+void ClosureRunner::clear(void) {
+    for(long i = 0; i < (long)code_cells.size(); i++) {
+        if(code_cells[i] != 0) engine.cache.cover(i, i + 1, -1);
+    }
+
+    if(!blocks.empty()) stats.rebuilds++;
+
+    blocks.clear();
+    block_at.clear();
+    code_cells.clear();
+
+    tape_data = engine.tape.data();
+    tape_size = engine.tape.size();
+    generation = engine.cache.generation;
+}
+
+/**
+ * Run the block at the current position, building it first if needed
+ *
+ * @returns false if no block can be built there, nothing was run
+ */
+bool ClosureRunner::run_block(void) {
+    if(is_stale()) clear();
+
+    int index = get_block(engine.position);
+    if(index < 0) return false;
+
+    const ClosureBlock& block = blocks[index];
+    const ClosureOp* op = block.ops.data();
+    const ClosureOp* end = op + block.ops.size();
+
+    stats.block_runs++;
+
+    while(op != end && op->handler(*op, *this)) op++;
+
+    // a store which changed code or moved the tape already left the machine
+    // after its own instruction
+    if(is_stale()) {
+        clear();
+        return true;
+    }
+
+    if(!block.ends_in_jump) engine.position = block.end;
+    engine.steps += block.ops.size();
+    stats.retired += block.ops.size();
+
+    return true;
+}
+
+/**
+ * Run a single instruction on the engine
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int ClosureRunner::interpret(void) {
+    stats.interpreted++;
+    return engine.step();
+}
+
+/**
+ * Run one block, or one instruction on the engine if there is no block for
+ * the current position
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int ClosureRunner::step(void) {
+    return run_block() ? (unsigned int)PROGRAM_RUNNING : interpret();
+}
+
+/**
+ * Run until the program stops, can be called again after more input is
+ * pushed to resume
+ *
+ * @returns reason execution stopped
+ */
+unsigned int ClosureRunner::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+/**
+ * Print how much ran through blocks and how often they were rebuilt
+ *
+ * @param out stream to write to
+ */
+void ClosureStats::print(std::ostream& out) const {
+    char buffer[96];
+    auto line = [&](const char* name, unsigned long value) {
+        snprintf(buffer, sizeof(buffer), "%-22s %12lu", name, value);
+        out << buffer << std::endl;
+    };
+
+    line("BLOCKS", blocks);
+    line("BLOCK RUNS", block_runs);
+    line("RETIRED IN BLOCKS", retired);
+    line("INTERPRETED", interpreted);
+    line("REBUILDS", rebuilds);
+}
+
+}
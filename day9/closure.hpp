@@ -0,0 +1,123 @@
+#ifndef CLOSURE_HPP
+#define CLOSURE_HPP
+
+#include <vector>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // how a closure reads an operand, address mode operands inside the tape
+    // are resolved to a pointer when the block is built
+    enum {
+        READ_IMMEDIATE,
+        READ_POINTER,
+        READ_RELATIVE,
+        READ_KINDS
+    };
+
+    // how a closure writes its result, addresses past the end of the tape go
+    // through Engine::store so the tape can grow
+    enum {
+        WRITE_POINTER,
+        WRITE_RELATIVE,
+        WRITE_FAR,
+        WRITE_KINDS
+    };
+
+    // the most instructions bound into a single block
+    const int MAX_CLOSURE_OPS = 64;
+
+    class ClosureOp;
+    class ClosureRunner;
+
+    // returns false if the block ends at this op
+    typedef bool (*ClosureHandler)(const ClosureOp&, ClosureRunner&);
+
+    /**
+     * A single instruction bound to the handler for its opcode and operand
+     * kinds, with operands resolved as far as they can be before running
+     */
+    class ClosureOp {
+    public:
+        ClosureHandler handler;
+        long* pointers[3];
+        long args[3];
+        // position of the next instruction and the original instructions
+        // retired once this one is done
+        long next;
+        unsigned int retired;
+    };
+
+    /**
+     * A straight line run of instructions starting at position, ending in a
+     * jump or before an instruction the engine has to handle (input, halt)
+     */
+    class ClosureBlock {
+    public:
+        long position;
+        long end;
+        std::vector<ClosureOp> ops;
+        bool ends_in_jump;
+        bool valid;
+    };
+
+    /**
+     * Counts for blocks built and run, and for what had to fall back to the
+     * engine
+     */
+    class ClosureStats {
+    public:
+        unsigned long blocks;
+        unsigned long block_runs;
+        unsigned long retired;
+        unsigned long interpreted;
+        unsigned long rebuilds;
+
+        ClosureStats() : blocks(0), block_runs(0), retired(0), interpreted(0), rebuilds(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Runs an engine through chains of pre-bound handlers, one chain per basic
+     * block. Needs no executable memory, every handler is an ordinary
+     * function picked when the block is built. Blocks are thrown away
+     * whenever code is written to or the tape moves
+     */
+    class ClosureRunner {
+    public:
+        Engine& engine;
+        ClosureStats stats;
+
+        ClosureRunner(Engine& engine);
+        ~ClosureRunner();
+
+        unsigned int run(void);
+        unsigned int step(void);
+        bool run_block(void);
+        unsigned int interpret(void);
+        void clear(void);
+
+        bool store_slow(const ClosureOp& op, long location, long value);
+
+    private:
+        std::vector<ClosureBlock> blocks;
+        std::vector<int> block_at;
+        // tape and code as they were when the blocks were built
+        const long* tape_data;
+        size_t tape_size;
+        unsigned long generation;
+        // blocks covering each cell, shared into the engine's code coverage
+        std::vector<int> code_cells;
+        // address mode reads past the end of the tape point here
+        long zero;
+
+        int get_block(long position);
+        int compile(long position);
+        bool is_stale(void) const;
+    };
+
+}
+
+#endif // !CLOSURE_HPP
@@ -0,0 +1,167 @@
+#include "cluster.hpp"
+
+namespace intcode {
+
+Cluster::Cluster(const std::vector<long>& program, size_t size, unsigned long slice) : slice(slice),
+    monitor(nullptr), polling(false), poll_value(0) {
+
+    for(size_t i = 0; i < size; i++) {
+        nodes.emplace_back(new ClusterNode(program));
+        nodes.back()->engine.push_input({(long)i});
+    }
+}
+
+/**
+ * Hand the given value to nodes reading empty input instead of blocking them
+ *
+ * @param value value read on empty input
+ */
+void Cluster::set_poll_value(long value) {
+    polling = true;
+    poll_value = value;
+}
+
+/**
+ * Queue a packet for its destination, packets to addresses without a node
+ * go to the monitor
+ *
+ * @param packet packet to send
+ */
+void Cluster::send(const Packet& packet) {
+    stats.packets++;
+
+    if(packet.destination < 0 || packet.destination >= (long)nodes.size()) {
+        stats.unrouted++;
+        if(monitor != nullptr) monitor->unrouted(*this, packet);
+        return;
+    }
+
+    std::vector<long>& pending = nodes[packet.destination]->pending;
+    pending.push_back(packet.x);
+    pending.push_back(packet.y);
+}
+
+/**
+ * Returns if no node can make progress without a new packet
+ *
+ * @returns true if every node is finished or idle with nothing queued
+ */
+bool Cluster::is_idle(void) const {
+    for(auto& node : nodes) {
+        if(node->finished) continue;
+        if(!node->pending.empty()) return false;
+        if(polling ? node->polls < IDLE_POLLS : !node->blocked) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Deliver everything queued for a node and run it until it blocks, finishes
+ * or the slice runs out
+ *
+ * @param node node to run
+ */
+void Cluster::run_slice(ClusterNode& node) {
+    Engine& engine = node.engine;
+
+    if(!node.pending.empty()) {
+        engine.input.insert(engine.input.end(), node.pending.begin(), node.pending.end());
+        node.pending.clear();
+        node.polls = 0;
+        stats.batches++;
+    }
+
+    unsigned long start = engine.steps;
+    bool polled = false;
+    node.blocked = false;
+
+    while(engine.steps - start < slice) {
+        unsigned int reason = engine.step();
+        if(reason == PROGRAM_RUNNING) continue;
+
+        if(reason == INPUT_EMPTY) {
+            // a polling program gets one poll value per slice, the next read
+            // gives the other nodes a turn
+            if(polling && !polled) {
+                engine.input.push_back(poll_value);
+                node.polls++;
+                polled = true;
+                continue;
+            }
+            node.blocked = true;
+        } else {
+            node.finished = true;
+        }
+        break;
+    }
+
+    stats.steps += engine.steps - start;
+}
+
+/**
+ * Cut the outputs of a node into packets and queue them, a trailing partial
+ * packet is kept until the rest of it is written
+ *
+ * @param node node whose output to route
+ */
+void Cluster::route(ClusterNode& node) {
+    std::vector<long>& output = node.engine.output;
+    if(output.size() - node.routed >= 3) node.polls = 0;
+
+    for(; output.size() - node.routed >= 3; node.routed += 3) {
+        send({ output[node.routed], output[node.routed + 1], output[node.routed + 2] });
+    }
+
+    output.erase(output.begin(), output.begin() + node.routed);
+    node.routed = 0;
+}
+
+/**
+ * Run rounds until every node finished, or the cluster is idle and the
+ * monitor (if any) stops it
+ *
+ * @param max_rounds rounds to run at most
+ * @returns PROGRAM_FINISH if every node finished, INPUT_EMPTY if stopped
+ * while idle, PROGRAM_RUNNING if out of rounds
+ */
+unsigned int Cluster::run(unsigned long max_rounds) {
+    for(unsigned long round = 0; round < max_rounds; round++) {
+        stats.rounds++;
+
+        bool running = false;
+        for(auto& node : nodes) {
+            if(node->finished) continue;
+
+            // a blocked node would only block again
+            if(!polling && node->blocked && node->pending.empty()) {
+                running = true;
+                continue;
+            }
+
+            run_slice(*node);
+            route(*node);
+            running |= !node->finished;
+        }
+
+        if(!running) return PROGRAM_FINISH;
+
+        if(is_idle()) {
+            stats.idle_rounds++;
+            if(monitor == nullptr || !monitor->idle(*this)) return INPUT_EMPTY;
+        }
+    }
+
+    return PROGRAM_RUNNING;
+}
+
+void ClusterStats::print(std::ostream& out) const {
+    out << "ROUNDS " << rounds << std::endl;
+    out << "PACKETS " << packets << std::endl;
+    out << "UNROUTED " << unrouted << std::endl;
+    out << "BATCHES " << batches << std::endl;
+    out << "IDLE ROUNDS " << idle_rounds << std::endl;
+    out << "STEPS " << steps << std::endl;
+}
+
+}
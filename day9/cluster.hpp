@@ -0,0 +1,119 @@
+#ifndef CLUSTER_HPP
+#define CLUSTER_HPP
+
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // instructions a node runs per round before the router takes over
+    const unsigned long DEFAULT_SLICE = 4096;
+    // polls in a row without traffic before a polling node counts as idle
+    const unsigned int IDLE_POLLS = 2;
+
+    /**
+     * Three consecutive outputs of a node, the destination and two values
+     */
+    class Packet {
+    public:
+        long destination;
+        long x, y;
+    };
+
+    class Cluster;
+
+    /**
+     * Told about packets to addresses with no node behind them and about the
+     * cluster going idle, as a NAT would be
+     */
+    class ClusterMonitor {
+    public:
+        virtual ~ClusterMonitor() {}
+
+        virtual void unrouted(Cluster& cluster, const Packet& packet) = 0;
+
+        /**
+         * Called when every node is idle and nothing is in flight, packets
+         * sent from here are delivered in the next round
+         *
+         * @returns false to stop the cluster
+         */
+        virtual bool idle(Cluster& cluster) = 0;
+    };
+
+    /**
+     * A machine in the cluster, packets for it are queued here and handed to
+     * its engine in one go at the start of its next slice
+     */
+    class ClusterNode {
+    public:
+        std::vector<long> tape;
+        Engine engine;
+        std::vector<long> pending;
+        // outputs already routed
+        size_t routed;
+        // poll values read since the last packet in or out
+        unsigned int polls;
+        bool blocked;
+        bool finished;
+
+        ClusterNode(const std::vector<long>& program) : tape(program), engine(tape), routed(0), polls(0),
+            blocked(false), finished(false) {}
+    };
+
+    class ClusterStats {
+    public:
+        unsigned long rounds;
+        unsigned long packets;
+        unsigned long unrouted;
+        // node slices which delivered at least one packet
+        unsigned long batches;
+        unsigned long idle_rounds;
+        unsigned long steps;
+
+        ClusterStats() : rounds(0), packets(0), unrouted(0), batches(0), idle_rounds(0), steps(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Runs a fleet of machines exchanging packets. Every node boots with its
+     * address as its first input, then every round each node gets its queued
+     * packets and runs for a slice until it blocks on input, finishes or uses
+     * up the slice. Outputs are cut into packets and queued for their
+     * destination after each slice.
+     *
+     * Programs which block on empty input are idle once blocked with nothing
+     * queued. Programs which expect a value on empty input (a poll value,
+     * such as -1) get one per slice and are idle after IDLE_POLLS of them in
+     * a row without traffic
+     */
+    class Cluster {
+    public:
+        std::vector<std::unique_ptr<ClusterNode>> nodes;
+        ClusterStats stats;
+        unsigned long slice;
+        // may be null, without a monitor the cluster stops when idle
+        ClusterMonitor* monitor;
+
+        Cluster(const std::vector<long>& program, size_t size, unsigned long slice = DEFAULT_SLICE);
+
+        void set_poll_value(long value);
+        void send(const Packet& packet);
+        bool is_idle(void) const;
+        unsigned int run(unsigned long max_rounds = ~0UL);
+
+    private:
+        bool polling;
+        long poll_value;
+
+        void run_slice(ClusterNode& node);
+        void route(ClusterNode& node);
+    };
+
+}
+
+#endif // !CLUSTER_HPP
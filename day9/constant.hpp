@@ -0,0 +1,153 @@
+#ifndef CONSTANT_HPP
+#define CONSTANT_HPP
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+
+#include "core.hpp"
+
+namespace intcode {
+
+    /**
+     * Copy a program into a fixed size tape, the cells after the program are
+     * zero and serve as the memory past its end
+     *
+     * @param program program values
+     * @returns tape of SIZE cells
+     */
+    template <size_t SIZE, size_t LENGTH>
+    constexpr std::array<long, SIZE> make_tape(const long (&program)[LENGTH]) {
+        static_assert(LENGTH <= SIZE, "program does not fit on the tape");
+
+        std::array<long, SIZE> tape{};
+        for(size_t i = 0; i < LENGTH; i++) tape[i] = program[i];
+
+        return tape;
+    }
+
+    /**
+     * Machine over a fixed size tape which can run entirely at compile time,
+     * for programs embedded as constants. Opcodes go through the same core as
+     * the engine, see core.hpp. The tape can not grow, a write past its end
+     * fails the same way a write to a negative address does, which in a
+     * constant expression is a compile error
+     */
+    template <size_t SIZE, size_t INPUTS = 16, size_t OUTPUTS = 64>
+    class ConstantMachine {
+    public:
+        std::array<long, SIZE> tape;
+        long position;
+        long relative_base;
+        std::array<long, INPUTS> input;
+        size_t inputs_read;
+        size_t input_count;
+        std::array<long, OUTPUTS> output;
+        size_t output_count;
+        unsigned long steps;
+
+        constexpr ConstantMachine(const std::array<long, SIZE>& tape) : tape(tape), position(0),
+            relative_base(0), input{}, inputs_read(0), input_count(0), output{}, output_count(0), steps(0) {}
+
+        constexpr long load(long location) const {
+            if(location < 0) {
+                throw std::runtime_error("Attempted read from out of bounds address " + std::to_string(location));
+            }
+            return location < (long)SIZE ? tape[location] : 0;
+        }
+
+        constexpr long read(int mode, long arg) const {
+            switch(mode) {
+                case MODE_IMMEDIATE: return arg;
+                case MODE_RELATIVE: return load(relative_base + arg);
+                default: return load(arg);
+            }
+        }
+
+        constexpr long address(int mode, long arg) const {
+            return (mode == MODE_RELATIVE) ? relative_base + arg : arg;
+        }
+
+        constexpr void store(long location, long value) {
+            if(location < 0 || location >= (long)SIZE) {
+                throw std::runtime_error("Attempted write to out of bounds address " + std::to_string(location));
+            }
+            tape[location] = value;
+        }
+
+        constexpr bool has_input(void) const {
+            return inputs_read < input_count;
+        }
+
+        constexpr long next_input(void) {
+            return input[inputs_read++];
+        }
+
+        constexpr void emit(long value) {
+            if(output_count >= OUTPUTS) throw std::runtime_error("Output buffer is full");
+            output[output_count++] = value;
+        }
+
+        constexpr void push_input(long value) {
+            if(input_count >= INPUTS) throw std::runtime_error("Input buffer is full");
+            input[input_count++] = value;
+        }
+
+        /**
+         * Execute a single instruction
+         *
+         * @returns PROGRAM_RUNNING if execution can continue, otherwise the
+         * reason execution stopped
+         */
+        constexpr unsigned int step(void) {
+            if(position < 0 || position >= (long)SIZE) return OUT_OF_INSTRUCTIONS;
+
+            long value = tape[position];
+            unsigned int opcode = get_opcode(value);
+            int modes[3] = { get_mode(value, 0), get_mode(value, 1), get_mode(value, 2) };
+            long args[3] = { 0, 0, 0 };
+
+            int operands = get_operand_count(opcode);
+            for(int i = 0; i < operands; i++) args[i] = load(position + i + 1);
+
+            unsigned int reason = execute(*this, opcode, modes, args);
+            if(reason == PROGRAM_RUNNING) steps++;
+
+            return reason;
+        }
+
+        /**
+         * Run until the program stops, can be called again after more input
+         * is pushed to resume
+         *
+         * @returns reason execution stopped
+         */
+        constexpr unsigned int run(void) {
+            unsigned int reason = PROGRAM_RUNNING;
+            while((reason = step()) == PROGRAM_RUNNING);
+
+            return reason;
+        }
+    };
+
+    /**
+     * Run a program on the given inputs
+     *
+     * @param tape program tape
+     * @param inputs input values, in order
+     * @returns machine after it stopped
+     */
+    template <size_t SIZE, size_t INPUTS = 16, size_t OUTPUTS = 64>
+    constexpr ConstantMachine<SIZE, INPUTS, OUTPUTS> run_constant(const std::array<long, SIZE>& tape,
+        std::initializer_list<long> inputs = {}) {
+
+        ConstantMachine<SIZE, INPUTS, OUTPUTS> machine(tape);
+        for(long value : inputs) machine.push_input(value);
+        machine.run();
+
+        return machine;
+    }
+
+}
+
+#endif // !CONSTANT_HPP
@@ -0,0 +1,157 @@
+#ifndef CORE_HPP
+#define CORE_HPP
+
+#include <stdexcept>
+#include <string>
+
+#include "intcode.hpp"
+
+namespace intcode {
+
+    // real opcodes, as they appear in the last two digits of an instruction
+    enum {
+        OP_ADD = 1,
+        OP_MULTI = 2,
+        OP_INPUT = 3,
+        OP_OUTPUT = 4,
+        OP_JUMP_TRUE = 5,
+        OP_JUMP_FALSE = 6,
+        OP_LESS_THAN = 7,
+        OP_EQUALS = 8,
+        OP_ADJUST_BASE = 9,
+        OP_HALT = 99
+    };
+
+    // parameter modes
+    enum {
+        MODE_ADDRESS = 0,
+        MODE_IMMEDIATE = 1,
+        MODE_RELATIVE = 2
+    };
+
+    /**
+     * Get the amount of operands an opcode takes
+     *
+     * @param opcode real opcode
+     * @returns operand count, 0 for unknown opcodes
+     */
+    constexpr int get_operand_count(unsigned int opcode) {
+        switch(opcode) {
+            case OP_ADD:
+            case OP_MULTI:
+            case OP_LESS_THAN:
+            case OP_EQUALS:
+                return 3;
+            case OP_JUMP_TRUE:
+            case OP_JUMP_FALSE:
+                return 2;
+            case OP_INPUT:
+            case OP_OUTPUT:
+            case OP_ADJUST_BASE:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     * Get the opcode of a raw instruction, negative instructions can never be
+     * valid and get an opcode which will never be handled
+     *
+     * @param value instruction as it appears on the tape
+     * @returns opcode
+     */
+    constexpr unsigned int get_opcode(long value) {
+        return (value >= 0) ? value % 100 : 0;
+    }
+
+    /**
+     * Get the mode of one of the operands of a raw instruction
+     *
+     * @param value instruction as it appears on the tape
+     * @param operand operand index, from 0
+     * @returns parameter mode
+     */
+    constexpr int get_mode(long value, int operand) {
+        long divisor = 100;
+        for(int i = 0; i < operand; i++) divisor *= 10;
+        return (value / divisor) % 10;
+    }
+
+    /**
+     * Execute a single real instruction on any machine, so that every machine
+     * agrees on what an opcode does. The machine supplies position and
+     * relative_base members along with read, address, store, has_input,
+     * next_input and emit, and is left at the next instruction
+     *
+     * @param machine machine to execute on
+     * @param opcode real opcode
+     * @param modes parameter modes
+     * @param args raw operand values
+     * @returns PROGRAM_RUNNING if execution can continue, otherwise the
+     * reason execution stopped
+     */
+    template <typename MACHINE>
+    constexpr unsigned int execute(MACHINE& machine, unsigned int opcode, const int* modes, const long* args) {
+        switch(opcode) {
+            case OP_ADD:
+                machine.store(machine.address(modes[2], args[2]),
+                    machine.read(modes[0], args[0]) + machine.read(modes[1], args[1]));
+                machine.position += 4;
+                break;
+            case OP_MULTI:
+                machine.store(machine.address(modes[2], args[2]),
+                    machine.read(modes[0], args[0]) * machine.read(modes[1], args[1]));
+                machine.position += 4;
+                break;
+            case OP_INPUT:
+                if(!machine.has_input()) return INPUT_EMPTY;
+                machine.store(machine.address(modes[0], args[0]), machine.next_input());
+                machine.position += 2;
+                break;
+            case OP_OUTPUT:
+                machine.emit(machine.read(modes[0], args[0]));
+                machine.position += 2;
+                break;
+            case OP_JUMP_TRUE:
+            case OP_JUMP_FALSE: {
+                long test_value = machine.read(modes[0], args[0]);
+                bool taken = (opcode == OP_JUMP_TRUE) ? (test_value != 0) : (test_value == 0);
+
+                if(taken) {
+                    long location = machine.read(modes[1], args[1]);
+                    if(location < 0) {
+                        throw std::runtime_error("Attempted to jump to out of bounds address " + std::to_string(location));
+                    }
+                    machine.position = location;
+                } else {
+                    machine.position += 3;
+                }
+                break;
+            }
+            case OP_LESS_THAN:
+                machine.store(machine.address(modes[2], args[2]),
+                    machine.read(modes[0], args[0]) < machine.read(modes[1], args[1]));
+                machine.position += 4;
+                break;
+            case OP_EQUALS:
+                machine.store(machine.address(modes[2], args[2]),
+                    machine.read(modes[0], args[0]) == machine.read(modes[1], args[1]));
+                machine.position += 4;
+                break;
+            case OP_ADJUST_BASE:
+                machine.relative_base += machine.read(modes[0], args[0]);
+                machine.position += 2;
+                break;
+            case OP_HALT:
+                return PROGRAM_FINISH;
+            default:
+                return UNKNOWN_OPCODE;
+        }
+
+        return PROGRAM_RUNNING;
+    }
+
+}
+
+#endif // !CORE_HPP
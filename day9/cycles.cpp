@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+#include "cycles.hpp"
+
+namespace intcode {
+
+// no comparison flips within this many iterations
+const long NEVER = LONG_MAX;
+
+static unsigned long mix(unsigned long value) {
+    value += 0x9e3779b97f4a7c15UL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9UL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebUL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * Hash of a single cell, zero cells hash to 0 so that growing the tape
+ * leaves every digest as it was
+ */
+static unsigned long hash_cell(long location, long value) {
+    return (value == 0) ? 0 : mix(mix(location) ^ (unsigned long)value);
+}
+
+CycleDetector::CycleDetector(Engine& engine) : engine(engine), tape_digest(0), inputs_read(0),
+    outputs_written(0), confirming(false),
+    confirm_hash(0), confirm_position(0), confirm_base(0), confirm_inputs(0), confirm_outputs(0),
+    head(-1), tracing(false), start_base(0), start_inputs(0), start_outputs(0), start_steps(0) {
+
+    // traces need every instruction on its own
+    engine.optimize = false;
+    engine.cache.clear();
+    engine.watcher = this;
+
+    long pages = (engine.tape.size() + DIGEST_PAGE_SIZE - 1) / DIGEST_PAGE_SIZE;
+    page_digests.resize(pages, 0);
+    page_dirty.resize(pages, true);
+    for(long page = 0; page < pages; page++) dirty_pages.push_back(page);
+    refresh_digest();
+}
+
+CycleDetector::~CycleDetector() {
+    engine.watcher = nullptr;
+}
+
+void CycleDetector::stored(long location, long old_value) {
+    long page = location / DIGEST_PAGE_SIZE;
+    if(page >= (long)page_dirty.size()) {
+        page_dirty.resize(page + 1, false);
+        page_digests.resize(page + 1, 0);
+    }
+    if(!page_dirty[page]) {
+        page_dirty[page] = true;
+        dirty_pages.push_back(page);
+    }
+
+    if(tracing && initial_values.find(location) == initial_values.end()) initial_values[location] = old_value;
+}
+
+/**
+ * Hash every page written since the last refresh again and fold the changes
+ * into the tape digest
+ */
+void CycleDetector::refresh_digest(void) {
+    const std::vector<long>& tape = engine.tape;
+
+    for(long page : dirty_pages) {
+        unsigned long digest = 0;
+        long end = std::min((page + 1) * DIGEST_PAGE_SIZE, (long)tape.size());
+        for(long i = page * DIGEST_PAGE_SIZE; i < end; i++) digest += hash_cell(i, tape[i]);
+
+        tape_digest += digest - page_digests[page];
+        page_digests[page] = digest;
+        page_dirty[page] = false;
+    }
+    dirty_pages.clear();
+}
+
+unsigned long CycleDetector::hash_state(void) const {
+    unsigned long hash = mix(engine.position);
+    hash = mix(hash ^ (unsigned long)engine.relative_base);
+    hash = mix(hash ^ tape_digest);
+    hash = mix(hash ^ inputs_read);
+    return mix(hash ^ outputs_written);
+}
+
+/**
+ * Look for a state seen before, a hash hit takes a copy of the state which a
+ * later hit on the same hash is compared against
+ *
+ * @returns true if the machine is known to be in a cycle
+ */
+bool CycleDetector::check_hang(void) {
+    refresh_digest();
+    unsigned long hash = hash_state();
+
+    if(confirming && hash == confirm_hash) {
+        if(engine.position == confirm_position && engine.relative_base == confirm_base &&
+            inputs_read == confirm_inputs && outputs_written == confirm_outputs &&
+            engine.tape == confirm_tape) {
+
+            return true;
+        }
+        confirming = false;
+    }
+
+    if(seen_states.find(hash) == seen_states.end()) {
+        if(seen_states.size() >= MAX_SEEN_STATES) seen_states.clear();
+        seen_states[hash] = engine.steps;
+        return false;
+    }
+
+    stats.hash_hits++;
+    if(!confirming) {
+        confirming = true;
+        confirm_hash = hash;
+        confirm_position = engine.position;
+        confirm_base = engine.relative_base;
+        confirm_inputs = inputs_read;
+        confirm_outputs = outputs_written;
+        confirm_tape = engine.tape;
+    }
+
+    return false;
+}
+
+void CycleDetector::begin_iteration(void) {
+    tracing = true;
+    current = Iteration();
+    initial_values.clear();
+    start_base = engine.relative_base;
+    start_inputs = inputs_read;
+    start_outputs = outputs_written;
+    start_steps = engine.steps;
+}
+
+void CycleDetector::end_iteration(void) {
+    for(auto& initial : initial_values) {
+        long now = engine.tape[initial.first];
+        if(now != initial.second) {
+            current.deltas.push_back({ initial.first, (long)((unsigned long)now - (unsigned long)initial.second) });
+        }
+    }
+    std::sort(current.deltas.begin(), current.deltas.end());
+
+    current.base_delta = engine.relative_base - start_base;
+    current.had_io = inputs_read != start_inputs || outputs_written != start_outputs;
+    current.steps = engine.steps - start_steps;
+    tracing = false;
+}
+
+/**
+ * Find the first iteration at which a condition on a value changing by a
+ * fixed amount per iteration gives a different answer than at iteration 0
+ *
+ * @param value value at iteration 0
+ * @param delta change per iteration
+ * @param less if the condition is value < 0, otherwise value == 0
+ * @returns iteration, NEVER if it never changes
+ */
+static long first_flip(__int128 value, __int128 delta, bool less) {
+    if(delta == 0) return NEVER;
+
+    __int128 flip;
+    if(less) {
+        if(value < 0 && delta > 0) flip = (-value + delta - 1) / delta;
+        else if(value >= 0 && delta < 0) flip = value / -delta + 1;
+        else return NEVER;
+    } else {
+        if(value == 0) return 1;
+        if(value % delta != 0 || -value / delta <= 0) return NEVER;
+        flip = -value / delta;
+    }
+
+    return (flip >= NEVER) ? NEVER : (long)flip;
+}
+
+/**
+ * Compare the last two iterations of the traced loop, if they prove every
+ * following one behaves the same up to some point apply all of those at once
+ *
+ * @returns true if iterations were skipped
+ */
+bool CycleDetector::try_fast_forward(void) {
+    const Iteration& first = history[0];
+    const Iteration& second = history[1];
+
+    if(first.had_io || second.had_io || first.base_delta != 0 || second.base_delta != 0) return false;
+    if(first.deltas != second.deltas || first.trace.size() != second.trace.size()) return false;
+
+    for(auto& delta : second.deltas) {
+        if(engine.cache.is_code(delta.first)) return false;
+    }
+
+    // iterations after the second one which still take the same path, the
+    // first iteration is 0
+    long flip = NEVER;
+
+    for(size_t i = 0; i < first.trace.size(); i++) {
+        const TracedInstruction& a = first.trace[i];
+        const TracedInstruction& b = second.trace[i];
+        if(a.position != b.position || a.opcode != b.opcode) return false;
+
+        __int128 left = a.values[0], right = a.values[1];
+        __int128 left_delta = (__int128)b.values[0] - a.values[0];
+        __int128 right_delta = (__int128)b.values[1] - a.values[1];
+
+        switch(a.opcode) {
+            case OP_MULTI:
+                // a product of two changing values is no longer linear
+                if(left_delta != 0 && right_delta != 0) return false;
+                break;
+            case OP_LESS_THAN:
+                flip = std::min(flip, first_flip(left - right, left_delta - right_delta, true));
+                break;
+            case OP_EQUALS:
+                flip = std::min(flip, first_flip(left - right, left_delta - right_delta, false));
+                break;
+            case OP_JUMP_TRUE:
+            case OP_JUMP_FALSE: {
+                flip = std::min(flip, first_flip(left, left_delta, false));
+                bool taken = (a.opcode == OP_JUMP_TRUE) ? (a.values[0] != 0) : (a.values[0] == 0);
+                if(taken && right_delta != 0) return false;
+                break;
+            }
+            case OP_ADJUST_BASE:
+                if(left_delta != 0) return false;
+                break;
+        }
+    }
+
+    if(flip <= 2) return false;
+    long count = (flip == NEVER) ? NEVER : flip - 2;
+
+    // stop short of any cell overflowing
+    for(auto& delta : second.deltas) {
+        __int128 value = engine.tape[delta.first];
+        __int128 room = (delta.second > 0) ? (LONG_MAX - value) / delta.second : (value - LONG_MIN) / -(__int128)delta.second;
+        if(room < count) count = (long)room;
+    }
+    count = std::min(count, (long)(LONG_MAX / std::max(1UL, second.steps)));
+    if(count <= 0) return false;
+
+    for(auto& delta : second.deltas) {
+        engine.tape[delta.first] += count * delta.second;
+        stored(delta.first, 0);
+    }
+
+    engine.steps += count * second.steps;
+    stats.fast_forwards++;
+    stats.skipped_steps += count * second.steps;
+
+    return true;
+}
+
+/**
+ * Called after every jump to the same or an earlier position
+ *
+ * @returns true if the machine is hung
+ */
+bool CycleDetector::on_backward_jump(void) {
+    stats.backward_jumps++;
+
+    if(check_hang()) return true;
+
+    long target = engine.position;
+    if(target != head) {
+        head = target;
+        history.clear();
+        if(failures[head] < MAX_LOOP_FAILURES) begin_iteration();
+        return false;
+    }
+
+    if(!tracing) return false;
+
+    end_iteration();
+
+    // a whole iteration that changed nothing will repeat forever
+    if(current.deltas.empty() && current.base_delta == 0 && !current.had_io) return true;
+
+    history.push_back(current);
+    if(history.size() == 2) {
+        if(try_fast_forward()) {
+            history.clear();
+        } else {
+            failures[head]++;
+            history.erase(history.begin());
+        }
+    }
+
+    if(failures[head] < MAX_LOOP_FAILURES) begin_iteration();
+
+    return false;
+}
+
+/**
+ * Execute a single instruction, tracing it if a loop iteration is being
+ * recorded
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, PROGRAM_HANG if it
+ * never can, otherwise the reason execution stopped
+ */
+unsigned int CycleDetector::step(void) {
+    long position = engine.position;
+    const std::vector<long>& tape = engine.tape;
+
+    if(tracing && position >= 0 && position < (long)tape.size()) {
+        if(current.trace.size() >= MAX_ITERATION_TRACE) {
+            tracing = false;
+            failures[head]++;
+            head = -1;
+        } else {
+            DecodedInstruction instruction = decode_instruction(tape, position);
+
+            TracedInstruction traced = { position, instruction.opcode, {0, 0} };
+            int reads = std::min(get_operand_count(instruction.opcode), 2);
+            if(instruction.opcode == OP_INPUT) reads = 0;
+            for(int i = 0; i < reads; i++) {
+                // the engine reports bad reads itself
+                long location = engine.address(instruction.modes[i], instruction.args[i]);
+                if(instruction.modes[i] == MODE_IMMEDIATE || location >= 0) {
+                    traced.values[i] = engine.read(instruction.modes[i], instruction.args[i]);
+                }
+            }
+            current.trace.push_back(traced);
+        }
+    }
+
+    unsigned int opcode = (position >= 0 && position < (long)tape.size()) ? get_opcode(tape[position]) : 0;
+    unsigned int reason = engine.step();
+    if(reason != PROGRAM_RUNNING) return reason;
+
+    if(opcode == OP_INPUT) inputs_read++;
+    else if(opcode == OP_OUTPUT) outputs_written++;
+
+    if(engine.position <= position && on_backward_jump()) return PROGRAM_HANG;
+
+    return PROGRAM_RUNNING;
+}
+
+/**
+ * Run until the program stops or is found to be hung
+ *
+ * @returns reason execution stopped
+ */
+unsigned int CycleDetector::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+void CycleStats::print(std::ostream& out) const {
+    out << "BACKWARD JUMPS " << backward_jumps << std::endl;
+    out << "FAST FORWARDS " << fast_forwards << std::endl;
+    out << "SKIPPED STEPS " << skipped_steps << std::endl;
+    out << "HASH HITS " << hash_hits << std::endl;
+}
+
+}
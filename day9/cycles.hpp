@@ -0,0 +1,127 @@
+#ifndef CYCLES_HPP
+#define CYCLES_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // tape cells hashed together into a single page digest
+    const long DIGEST_PAGE_SIZE = 64;
+    // instructions traced for a single loop iteration before giving up on it
+    const size_t MAX_ITERATION_TRACE = 4096;
+    // loops which could not be fast forwarded this often are no longer traced
+    const unsigned int MAX_LOOP_FAILURES = 8;
+    // state hashes remembered for hang detection before starting over
+    const size_t MAX_SEEN_STATES = 1 << 16;
+
+    /**
+     * An executed instruction and the operand values it read
+     */
+    class TracedInstruction {
+    public:
+        long position;
+        unsigned int opcode;
+        long values[2];
+    };
+
+    /**
+     * Everything a single loop iteration did, from one arrival at the loop
+     * head to the next
+     */
+    class Iteration {
+    public:
+        std::vector<TracedInstruction> trace;
+        // change of every written cell which ended up with a different value
+        std::vector<std::pair<long, long>> deltas;
+        long base_delta;
+        bool had_io;
+        unsigned long steps;
+    };
+
+    class CycleStats {
+    public:
+        unsigned long backward_jumps;
+        unsigned long fast_forwards;
+        unsigned long skipped_steps;
+        unsigned long hash_hits;
+
+        CycleStats() : backward_jumps(0), fast_forwards(0), skipped_steps(0), hash_hits(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Runs an engine one instruction at a time, looking at every backward jump
+     * for loops that can never end or whose effect is linear.
+     *
+     * Hangs are found two ways. A loop iteration that changes nothing is
+     * caught exactly. Longer cycles are caught by a hash of the position,
+     * relative base, i/o counts and per page tape digests, confirmed against
+     * a full copy of the state when the hash comes around again.
+     *
+     * Two consecutive iterations of a loop which took the same path, wrote
+     * the same deltas and only did affine arithmetic will keep doing so until
+     * one of their comparisons flips. That point is computed and the
+     * iterations in between are applied at once
+     */
+    class CycleDetector : public StoreWatcher {
+    public:
+        Engine& engine;
+        CycleStats stats;
+
+        CycleDetector(Engine& engine);
+        ~CycleDetector();
+
+        unsigned int step(void);
+        unsigned int run(void);
+
+        void stored(long location, long old_value) override;
+
+    private:
+        // per page digests, the total is kept up to date at backward jumps
+        std::vector<unsigned long> page_digests;
+        std::vector<bool> page_dirty;
+        std::vector<long> dirty_pages;
+        unsigned long tape_digest;
+
+        // inputs read and outputs written so far, unlike the queue sizes
+        // these never go back when input is pushed or output taken
+        unsigned long inputs_read, outputs_written;
+
+        std::unordered_map<unsigned long, unsigned long> seen_states;
+        // state copy taken on a hash hit, a hang once it is seen again
+        bool confirming;
+        unsigned long confirm_hash;
+        long confirm_position;
+        long confirm_base;
+        unsigned long confirm_inputs, confirm_outputs;
+        std::vector<long> confirm_tape;
+
+        // loop head being traced, -1 if none
+        long head;
+        bool tracing;
+        Iteration current;
+        std::unordered_map<long, long> initial_values;
+        long start_base;
+        unsigned long start_inputs, start_outputs;
+        unsigned long start_steps;
+        std::vector<Iteration> history;
+        std::unordered_map<long, unsigned int> failures;
+
+        void refresh_digest(void);
+        unsigned long hash_state(void) const;
+        bool check_hang(void);
+
+        void begin_iteration(void);
+        void end_iteration(void);
+        bool try_fast_forward(void);
+        bool on_backward_jump(void);
+    };
+
+}
+
+#endif // !CYCLES_HPP
@@ -0,0 +1,249 @@
+#include "engine.hpp"
+
+namespace intcode {
+
+/**
+ * Decode the instruction at the given position without going through strings,
+ * operands past the end of the tape are read as 0
+ *
+ * @param tape program tape
+ * @param position position of instruction
+ * @returns decoded instruction
+ */
+DecodedInstruction decode_instruction(const std::vector<long>& tape, long position) {
+    DecodedInstruction instruction;
+    long value = tape[position];
+
+    instruction.opcode = get_opcode(value);
+    for(int i = 0; i < 3; i++) instruction.modes[i] = get_mode(value, i);
+
+    int operands = get_operand_count(instruction.opcode);
+    for(int i = 0; i < operands; i++) {
+        long location = position + i + 1;
+        instruction.args[i] = (location < (long)tape.size()) ? tape[location] : 0;
+    }
+
+    instruction.length = operands + 1;
+    instruction.count = 1;
+
+    return instruction;
+}
+
+/**
+ * Get the decoded instruction at the given position, decoding (and fusing if
+ * requested) it if it is not already in the cache
+ *
+ * @param tape program tape
+ * @param position position of instruction
+ * @param optimize if peephole rules should be applied to new entries
+ * @param stats stats to update when a rule is applied, may be null
+ * @returns decoded entry, only valid until the cache is next modified
+ */
+const DecodedInstruction& DecodeCache::fetch(const std::vector<long>& tape, long position,
+    bool optimize, PeepholeStats* stats) {
+
+    if(has_entry(position)) return entries[position];
+
+    DecodedInstruction instruction = decode_instruction(tape, position);
+    if(optimize) apply_peephole(tape, position, instruction, stats);
+
+    insert(position, instruction);
+
+    return entries[position];
+}
+
+/**
+ * Place a decoded instruction into the cache and mark the cells it covers
+ * as code
+ *
+ * @param position position of instruction
+ * @param instruction decoded instruction
+ */
+void DecodeCache::insert(long position, const DecodedInstruction& instruction) {
+    long end = position + instruction.length;
+
+    if(end > (long)entries.size()) {
+        entries.resize(end);
+        coverage.resize(end, 0);
+    }
+
+    entries[position] = instruction;
+    for(long i = position; i < end; i++) coverage[i]++;
+}
+
+/**
+ * Mark cells as code for something other than a decoded entry (such as a
+ * compiled block) so that writes to them are caught the same way
+ *
+ * @param first first cell
+ * @param end one past the last cell
+ * @param delta 1 to mark, -1 to unmark
+ */
+void DecodeCache::cover(long first, long end, int delta) {
+    if(end > (long)entries.size()) {
+        entries.resize(end);
+        coverage.resize(end, 0);
+    }
+
+    for(long i = first; i < end; i++) {
+        // clear() may already have reset the cell
+        if(delta < 0 && coverage[i] == 0) continue;
+        coverage[i] += delta;
+    }
+}
+
+/**
+ * Throw away every entry which covers the given cell, called whenever a code
+ * cell is written to
+ *
+ * @param position written tape position
+ * @returns amount of fused entries that were thrown away
+ */
+int DecodeCache::invalidate(long position) {
+    if(!is_code(position)) return 0;
+
+    int fused = 0;
+    long first = std::max(0L, position - (MAX_DECODED_SPAN - 1));
+    for(long i = first; i <= position; i++) {
+        DecodedInstruction& entry = entries[i];
+        if(entry.length == 0 || i + (long)entry.length <= position) continue;
+
+        for(long j = i; j < i + (long)entry.length; j++) coverage[j]--;
+        if(entry.count > 1 || entry.opcode >= SUPER_MOVE) fused++;
+        entry = DecodedInstruction();
+    }
+
+    generation++;
+
+    return fused;
+}
+
+/**
+ * Throw away every decoded entry
+ */
+void DecodeCache::clear(void) {
+    entries.clear();
+    coverage.clear();
+    generation++;
+}
+
+/**
+ * Write a value to the tape, growing it if needed and dropping any decoded
+ * entries the write lands in
+ *
+ * @param location tape address
+ * @param value value to write
+ */
+void Engine::store(long location, long value) {
+    if(location < 0) {
+        throw std::runtime_error("Attempted write to out of bounds address " + std::to_string(location));
+    }
+
+    if(location >= (long)tape.size()) {
+        // grow geometrically so programs walking up memory don't resize on
+        // every write
+        tape.resize(std::max((size_t)location + 1, tape.size() + tape.size() / 2), 0L);
+    }
+
+    if(watcher != nullptr) watcher->stored(location, tape[location]);
+    tape[location] = value;
+
+    if(cache.is_code(location)) stats.deopts += cache.invalidate(location);
+}
+
+/**
+ * Queue values for the program to read, in the order given
+ *
+ * @param values input values
+ */
+void Engine::push_input(const std::vector<long>& values) {
+    input.insert(input.end(), values.begin(), values.end());
+}
+
+/**
+ * Execute a single decoded entry, which may stand in for several original
+ * instructions
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int Engine::step(void) {
+    if(position < 0 || position >= (long)tape.size()) return OUT_OF_INSTRUCTIONS;
+
+    // take a copy, the cache may be resized or invalidated by the instruction
+    DecodedInstruction instruction = cache.fetch(tape, position, optimize, &stats);
+    const int* modes = instruction.modes;
+    const long* args = instruction.args;
+
+    switch(instruction.opcode) {
+        case SUPER_MOVE:
+            store(address(modes[2], args[2]), read(modes[0], args[0]));
+            position += 4;
+            stats.executed[PeepholeStats::RULE_MOVE]++;
+            stats.eliminated[PeepholeStats::RULE_MOVE]++;
+            break;
+        case SUPER_CMP_JUMP: {
+            long start = position;
+            long left = read(modes[0], args[0]);
+            long right = read(modes[1], args[1]);
+            long result = (instruction.variant & CMP_EQUALS) ? (left == right) : (left < right);
+
+            store(address(modes[2], args[2]), result);
+
+            // the compare wrote into its own fused region, finish as a plain
+            // compare and let the jump be decoded again from the tape
+            if(!cache.has_entry(start)) {
+                position = start + 4;
+                steps += 1;
+                return PROGRAM_RUNNING;
+            }
+
+            stats.executed[PeepholeStats::RULE_CMP_JUMP]++;
+            stats.eliminated[PeepholeStats::RULE_CMP_JUMP]++;
+
+            bool taken = (instruction.variant & JUMP_ON_TRUE) ? (result != 0) : (result == 0);
+            if(taken) {
+                long location = read(modes[3], args[3]);
+                if(location < 0) {
+                    throw std::runtime_error("Attempted to jump to out of bounds address " + std::to_string(location));
+                }
+                position = location;
+            } else {
+                position += instruction.length;
+            }
+            break;
+        }
+        case SUPER_ADJUST_BASE:
+            relative_base += args[0];
+            position += instruction.length;
+            stats.executed[PeepholeStats::RULE_ADJUST_BASE]++;
+            stats.eliminated[PeepholeStats::RULE_ADJUST_BASE] += instruction.count - 1;
+            break;
+
+        default: {
+            // real opcodes share their semantics with every other machine
+            unsigned int reason = execute(*this, instruction.opcode, modes, args);
+            if(reason != PROGRAM_RUNNING) return reason;
+            break;
+        }
+    }
+
+    steps += instruction.count;
+
+    return PROGRAM_RUNNING;
+}
+
+/**
+ * Run the program until it finishes or can no longer continue, can be called
+ * again after more input is pushed to resume
+ *
+ * @returns reason execution stopped
+ */
+unsigned int Engine::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+}
@@ -0,0 +1,218 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include <vector>
+#include <deque>
+#include <stdexcept>
+
+#include "intcode.hpp"
+#include "core.hpp"
+
+namespace intcode {
+
+    // superinstructions created by the peephole pass, these never appear on
+    // the tape and only live inside of the decode cache
+    enum {
+        SUPER_MOVE = 100,
+        SUPER_CMP_JUMP = 101,
+        SUPER_ADJUST_BASE = 102
+    };
+
+    // variant bits for SUPER_CMP_JUMP
+    enum {
+        CMP_EQUALS = 1,
+        JUMP_ON_TRUE = 2
+    };
+
+    // the largest amount of tape cells a single decoded entry may cover
+    const int MAX_DECODED_SPAN = 8;
+
+    /**
+     * A pre-decoded instruction, arguments are the raw tape values following
+     * the instruction and modes are their matching parameter modes
+     */
+    class DecodedInstruction {
+    public:
+        unsigned int opcode;
+        // amount of tape cells covered by this instruction, 0 if not decoded
+        unsigned int length;
+        // amount of original instructions this entry stands in for
+        unsigned int count;
+        // extra information for superinstructions (compare/jump kind)
+        unsigned int variant;
+        int modes[4];
+        long args[4];
+
+        DecodedInstruction() : opcode(0), length(0), count(0), variant(0),
+            modes{0, 0, 0, 0}, args{0, 0, 0, 0} {}
+    };
+
+    DecodedInstruction decode_instruction(const std::vector<long>& tape, long position);
+
+    class PeepholeStats;
+
+    /**
+     * Caches decoded instructions by their tape position, tracking which tape
+     * cells are covered by code so that writes into code can be detected and
+     * the stale entries thrown away
+     */
+    class DecodeCache {
+    public:
+        std::vector<DecodedInstruction> entries;
+        // amount of decoded entries which cover the given cell
+        std::vector<unsigned char> coverage;
+        // bumped every time an entry is invalidated by a write
+        unsigned long generation;
+
+        DecodeCache() : generation(0) {}
+
+        /**
+         * Returns if the given tape cell is part of any decoded instruction
+         *
+         * @param position tape position
+         * @returns true if position is covered by code
+         */
+        bool is_code(long position) const {
+            return position >= 0 && position < (long)coverage.size() && coverage[position] != 0;
+        }
+
+        /**
+         * Returns if there is a decoded entry starting at the given position
+         *
+         * @param position tape position
+         * @returns true if an entry is present
+         */
+        bool has_entry(long position) const {
+            return position >= 0 && position < (long)entries.size() && entries[position].length != 0;
+        }
+
+        const DecodedInstruction& fetch(const std::vector<long>& tape, long position,
+            bool optimize, PeepholeStats* stats);
+        void insert(long position, const DecodedInstruction& instruction);
+        void cover(long first, long end, int delta);
+        int invalidate(long position);
+        void clear(void);
+    };
+
+    /**
+     * Counts for each peephole rule, sites are the amount of times the rule
+     * was applied while decoding, executed the amount of times the resulting
+     * superinstruction ran and eliminated the amount of original instructions
+     * which never had to be dispatched because of it
+     */
+    class PeepholeStats {
+    public:
+        enum { RULE_MOVE, RULE_CMP_JUMP, RULE_ADJUST_BASE, RULE_COUNT };
+
+        unsigned long sites[RULE_COUNT];
+        unsigned long executed[RULE_COUNT];
+        unsigned long eliminated[RULE_COUNT];
+        // amount of fused entries thrown away because of self modification
+        unsigned long deopts;
+
+        PeepholeStats() : sites{0}, executed{0}, eliminated{0}, deopts(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    bool apply_peephole(const std::vector<long>& tape, long position,
+        DecodedInstruction& instruction, PeepholeStats* stats);
+
+    /**
+     * Told about every write that goes through Engine::store, before the
+     * value changes
+     */
+    class StoreWatcher {
+    public:
+        virtual ~StoreWatcher() {}
+        virtual void stored(long location, long old_value) = 0;
+    };
+
+    /**
+     * Resumable machine which executes instructions out of a decode cache
+     * instead of parsing every instruction on every step, runs in place on the
+     * given tape the same way run_program does
+     */
+    class Engine {
+    public:
+        std::vector<long>& tape;
+        long position;
+        long relative_base;
+        std::deque<long> input;
+        std::vector<long> output;
+        DecodeCache cache;
+        PeepholeStats stats;
+        // when false every instruction is decoded on its own with no fusing
+        bool optimize;
+        // amount of original instructions retired
+        unsigned long steps;
+        // may be null
+        StoreWatcher* watcher;
+
+        Engine(std::vector<long>& tape, bool optimize = true) : tape(tape), position(0),
+            relative_base(0), optimize(optimize), steps(0), watcher(nullptr) {}
+
+        /**
+         * Read a tape cell, cells outside of the tape read as 0
+         *
+         * @param location tape address
+         * @returns value at address
+         */
+        long load(long location) const {
+            if(location < 0) {
+                throw std::runtime_error("Attempted read from out of bounds address " + std::to_string(location));
+            }
+            return location < (long)tape.size() ? tape[location] : 0;
+        }
+
+        /**
+         * Get the value of an operand given its mode
+         *
+         * @param mode parameter mode
+         * @param arg raw operand value
+         * @returns intended value
+         */
+        long read(int mode, long arg) const {
+            switch(mode) {
+                case MODE_IMMEDIATE: return arg;
+                case MODE_RELATIVE: return load(relative_base + arg);
+                default: return load(arg);
+            }
+        }
+
+        /**
+         * Get the address an operand writes to, immediate mode is treated as
+         * address mode for writes
+         *
+         * @param mode parameter mode
+         * @param arg raw operand value
+         * @returns address
+         */
+        long address(int mode, long arg) const {
+            return (mode == MODE_RELATIVE) ? relative_base + arg : arg;
+        }
+
+        // i/o used by the shared opcode core, see core.hpp
+        bool has_input(void) const {
+            return !input.empty();
+        }
+
+        long next_input(void) {
+            long value = input.front();
+            input.pop_front();
+            return value;
+        }
+
+        void emit(long value) {
+            output.push_back(value);
+        }
+
+        void store(long location, long value);
+        void push_input(const std::vector<long>& values);
+        unsigned int run(void);
+        unsigned int step(void);
+    };
+
+}
+
+#endif // !ENGINE_HPP
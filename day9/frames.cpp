@@ -0,0 +1,188 @@
+#include <cstdio>
+
+#include "frames.hpp"
+
+namespace intcode {
+
+/**
+ * Returns if an instruction is a jump whose target is read through the
+ * relative base, which is how a function returns to its caller
+ */
+static bool is_return_jump(const DecodedInstruction& instruction) {
+    return (instruction.opcode == OP_JUMP_TRUE || instruction.opcode == OP_JUMP_FALSE) &&
+        instruction.modes[1] == MODE_RELATIVE;
+}
+
+/**
+ * Get the constant an instruction stores, for adds of 0 and multiplies by 1
+ * with both operands immediate
+ *
+ * @param instruction decoded instruction
+ * @param value set to the stored value
+ * @returns true if the instruction stores a constant
+ */
+static bool get_stored_constant(const DecodedInstruction& instruction, long& value) {
+    if(instruction.modes[0] != MODE_IMMEDIATE || instruction.modes[1] != MODE_IMMEDIATE) return false;
+
+    const long* args = instruction.args;
+    if(instruction.opcode == OP_ADD) {
+        value = args[0] + args[1];
+        return true;
+    }
+    if(instruction.opcode == OP_MULTI && (args[0] == 1 || args[1] == 1)) {
+        value = args[0] * args[1];
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Returns if an instruction always jumps to a constant target
+ */
+static bool is_constant_jump(const DecodedInstruction& instruction) {
+    if(instruction.modes[0] != MODE_IMMEDIATE || instruction.modes[1] != MODE_IMMEDIATE) return false;
+
+    if(instruction.opcode == OP_JUMP_TRUE) return instruction.args[0] != 0;
+    if(instruction.opcode == OP_JUMP_FALSE) return instruction.args[0] == 0;
+
+    return false;
+}
+
+/**
+ * Find functions and calls by the patterns compiled Intcode uses for them,
+ * the program is decoded linearly so data between functions may be read as
+ * instructions, patterns are strict enough that this is rarely a problem
+ *
+ * @param tape program tape
+ * @returns found frames and call sites
+ */
+FrameAnalysis analyze_frames(const std::vector<long>& tape) {
+    std::vector<DecodedInstruction> instructions;
+    std::vector<long> positions;
+
+    for(long position = 0; position < (long)tape.size();) {
+        DecodedInstruction instruction = decode_instruction(tape, position);
+        bool valid = instruction.opcode == OP_HALT || get_operand_count(instruction.opcode) != 0;
+        for(int i = 0; i < 3; i++) valid = valid && instruction.modes[i] <= MODE_RELATIVE;
+
+        if(!valid) {
+            position++;
+            continue;
+        }
+
+        instructions.push_back(instruction);
+        positions.push_back(position);
+        position += instruction.length;
+    }
+
+    FrameAnalysis analysis;
+
+    Frame current(0, 0);
+    bool open = false;
+    // base adjusts inside the function since its entry
+    long shift = 0;
+
+    auto close = [&]() {
+        if(open && !current.returns.empty()) analysis.frames.push_back(current);
+        open = false;
+    };
+
+    for(size_t i = 0; i < instructions.size(); i++) {
+        const DecodedInstruction& instruction = instructions[i];
+        const DecodedInstruction* next = (i + 1 < instructions.size()) ? &instructions[i + 1] : nullptr;
+
+        if(instruction.opcode == OP_ADJUST_BASE && instruction.modes[0] == MODE_IMMEDIATE) {
+            long amount = instruction.args[0];
+
+            if(amount > 0) {
+                close();
+                current = Frame(positions[i], amount);
+                open = true;
+                shift = 0;
+                continue;
+            }
+
+            if(open && -amount == current.size + shift && next != nullptr && is_return_jump(*next)) {
+                current.returns.push_back(positions[i + 1]);
+                continue;
+            }
+
+            shift += amount;
+            continue;
+        }
+
+        if(open) {
+            int operands = get_operand_count(instruction.opcode);
+            for(int j = 0; j < operands; j++) {
+                if(instruction.modes[j] != MODE_RELATIVE) continue;
+
+                long offset = instruction.args[j] + shift;
+                if(current.accesses == 0) current.low = current.high = offset;
+                current.low = std::min(current.low, offset);
+                current.high = std::max(current.high, offset);
+                current.accesses++;
+            }
+        }
+
+        long value;
+        if(instruction.modes[2] == MODE_RELATIVE && get_stored_constant(instruction, value) &&
+            next != nullptr && is_constant_jump(*next) && value == positions[i + 1] + (long)next->length) {
+
+            analysis.calls.push_back({ positions[i], next->args[1], value, instruction.args[2] });
+        }
+    }
+    close();
+
+    for(size_t i = 0; i < analysis.frames.size(); i++) {
+        const Frame& frame = analysis.frames[i];
+        analysis.low = (i == 0) ? frame.low : std::min(analysis.low, frame.low);
+        analysis.high = (i == 0) ? frame.high : std::max(analysis.high, frame.high);
+    }
+
+    return analysis;
+}
+
+/**
+ * Get the frame entered at the given position
+ *
+ * @param entry position of the entry adjust
+ * @returns frame, null if there is none
+ */
+const Frame* FrameAnalysis::get_frame(long entry) const {
+    for(const Frame& frame : frames) {
+        if(frame.entry == entry) return &frame;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Print every frame with the offsets it touches and every call site
+ *
+ * @param out stream to write to
+ */
+void FrameAnalysis::print(std::ostream& out) const {
+    char buffer[128];
+
+    out << "FRAMES" << std::endl;
+    for(const Frame& frame : frames) {
+        int calls_to = 0;
+        for(const CallSite& call : calls) calls_to += (call.target == frame.entry);
+
+        snprintf(buffer, sizeof(buffer), "%8ld SIZE %4ld OFFSETS %4ld..%-4ld ACCESSES %4lu RETURNS %zu CALLS %d",
+            frame.entry, frame.size, frame.low, frame.high, frame.accesses, frame.returns.size(), calls_to);
+        out << buffer << std::endl;
+    }
+
+    out << std::endl << "CALL SITES" << std::endl;
+    for(const CallSite& call : calls) {
+        snprintf(buffer, sizeof(buffer), "%8ld -> %-8ld RETURN %-8ld SLOT %ld",
+            call.position, call.target, call.return_address, call.slot);
+        out << buffer << std::endl;
+    }
+
+    out << std::endl << "FRAME OFFSETS " << low << ".." << high << std::endl;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef FRAMES_HPP
+#define FRAMES_HPP
+
+#include <vector>
+#include <ostream>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    /**
+     * A function found by its frame pattern, entered through an adjust base
+     * by a positive constant and left through the matching negative adjust
+     * followed by a jump through a relative cell. Offsets are relative to the
+     * base after the entry adjust
+     */
+    class Frame {
+    public:
+        long entry;
+        long size;
+        std::vector<long> returns;
+        long low, high;
+        unsigned long accesses;
+
+        Frame(long entry, long size) : entry(entry), size(size), low(0), high(0), accesses(0) {}
+    };
+
+    /**
+     * A store of a return address into a relative cell directly followed by
+     * a jump to a constant target
+     */
+    class CallSite {
+    public:
+        long position;
+        long target;
+        long return_address;
+        long slot;
+    };
+
+    /**
+     * Frames and calls found by a linear pass over the program, low and high
+     * cover every relative offset any frame touches, which the IR tier
+     * sizes its frame window by
+     */
+    class FrameAnalysis {
+    public:
+        std::vector<Frame> frames;
+        std::vector<CallSite> calls;
+        long low, high;
+
+        FrameAnalysis() : low(0), high(0) {}
+
+        const Frame* get_frame(long entry) const;
+        void print(std::ostream& out) const;
+    };
+
+    FrameAnalysis analyze_frames(const std::vector<long>& tape);
+
+}
+
+#endif // !FRAMES_HPP
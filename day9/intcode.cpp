@@ -1,4 +1,7 @@
 #include "intcode.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "tiering.hpp"
 
 namespace intcode {
 
@@ -30,6 +33,28 @@ Instruction parse_instruction(long instruction) {
     return Instruction(opcode, flags);
 }
 
+/**
+ * Get the mnemonic name of an opcode
+ * 
+ * @param opcode opcode to name
+ * @returns name of opcode, UNKNOWN if it is not a valid opcode
+ */
+const char* get_opcode_name(unsigned int opcode) {
+    switch(opcode) {
+        case 1: return "ADD";
+        case 2: return "MULTI";
+        case 3: return "INPUT";
+        case 4: return "OUTPUT";
+        case 5: return "JUMP_TRUE";
+        case 6: return "JUMP_FALSE";
+        case 7: return "LESS_THAN";
+        case 8: return "EQUALS";
+        case 9: return "ADJUST_BASE";
+        case 99: return "HALT";
+        default: return "UNKNOWN";
+    }
+}
+
 /**
  * Given a file location, grab opcodes from file
  * 
@@ -442,9 +467,16 @@ int instr_adjust_base(int offset, InstructionBundle& bundle) {
  * @param input a vector of integers to use as input
  * @param state a run state to resume running from, default argument starts from 
  *  beginning of program
+ * @param options (default = no instrumentation) profiler and tracer to feed
+ *  every executed instruction to, and tiering to hand hot code over to
  * @returns a run state holding the state of the program
  */ 
-RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunState state) {
+RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunState state,
+    RunOptions options) {
+    Profiler* profiler = options.profiler;
+    TraceRecorder* tracer = options.tracer;
+    Tiering* tiering = options.tiering;
+
     opcodefn operations[16] = {0};
     operations[1] = &instr_add;
     operations[2] = &instr_multi;
@@ -465,9 +497,20 @@ RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunSta
 
     InstructionBundle bundle(0, opcodes, input_stream, output);
 
+    if(profiler != nullptr) profiler->resume();
+
+    // blocks start where execution resumes and after every jump
+    bool block_start = true;
+
     for(int i = state.opcode_position; i < opcodes.size();) {
+        if(tiering != nullptr && block_start && tiering->enter_block(i)) {
+            return tiering->run_from(opcodes, i, bundle.relative_base, input_stream, output);
+        }
+
         Instruction current_instruction = parse_instruction(opcodes[i]);
 
+        if(profiler != nullptr) profiler->begin_instruction(i, opcodes[i]);
+
         if(current_instruction.opcode == 99) return RunState(i, output, PROGRAM_FINISH);
         
         opcodefn opcode_handler = operations[current_instruction.opcode];
@@ -475,19 +518,7 @@ RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunSta
         if(opcode_handler != 0) {
 
             #ifdef DEBUG_STACK_TRACE
-            std::map<int, std::string> ops = {
-                {1, "ADD"},
-                {2, "MULTI"},
-                {3, "INPUT"},
-                {4, "OUTPUT"},
-                {5, "JUMP_TRUE"},
-                {6, "JUMP_FALSE"},
-                {7, "LESS_THAN"},
-                {8, "EQUALS"},
-                {9, "ADJUST_BASE"},
-            };
-            
-            std::cout << current_instruction.to_string() << " (" << ops.at(current_instruction.opcode) << ")" << std::endl;
+            std::cout << current_instruction.to_string() << " (" << get_opcode_name(current_instruction.opcode) << ")" << std::endl;
             #endif // DEBUG_STACK_TRACE
 
             // special case, input read on empty input stream returns broken state
@@ -495,8 +526,16 @@ RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunSta
                 return RunState(i, output, INPUT_EMPTY);
             }
 
+            if(tracer != nullptr) tracer->begin(i, opcodes, bundle.relative_base);
+
             i = (*opcode_handler)(i, bundle);
 
+            block_start = current_instruction.opcode == 5 || current_instruction.opcode == 6;
+            if(tiering != nullptr) tiering->retire_baseline();
+
+            if(profiler != nullptr) profiler->end_instruction();
+            if(tracer != nullptr) tracer->end(opcodes);
+
             #ifdef DEBUG_STACK_TRACE
             std::cout << std::endl;
             #endif // DEBUG_STACK_TRACE
@@ -66,7 +66,11 @@ namespace intcode {
         PROGRAM_BEGIN,
         OUT_OF_INSTRUCTIONS,
         INPUT_EMPTY,
-        UNKNOWN_OPCODE
+        UNKNOWN_OPCODE,
+        PROGRAM_RUNNING,
+        // the machine returned to an earlier state without any i/o, it can
+        // never stop on its own
+        PROGRAM_HANG
     };
 
     /**
@@ -122,7 +126,27 @@ namespace intcode {
         }
     };
 
+    class Profiler;
+    class TraceRecorder;
+    class Tiering;
+
+    /**
+     * Optional instrumentation for run_program, everything is off by default
+     */
+    class RunOptions {
+    public:
+        // counts executions and times blocks, see profiler.hpp
+        Profiler* profiler;
+        // records every executed instruction to a trace file, see trace.hpp
+        TraceRecorder* tracer;
+        // moves hot code to the faster tiers, see tiering.hpp
+        Tiering* tiering;
+
+        RunOptions() : profiler(nullptr), tracer(nullptr), tiering(nullptr) {}
+    };
+
     Instruction parse_instruction(long instruction);
+    const char* get_opcode_name(unsigned int opcode);
     std::vector<long> get_opcodes_from_file(std::string file_location);
 
     typedef int (*opcodefn)(int, InstructionBundle&); 
@@ -143,7 +167,8 @@ namespace intcode {
     int instr_adjust_base(int offset, InstructionBundle& bundle);
     /* END INSTRUCTION FUNCTIONS */
 
-    RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunState state = RunState());
+    RunState run_program(std::vector<long>& opcodes, std::vector<long> input, RunState state = RunState(),
+        RunOptions options = RunOptions());
 }
 
 
@@ -0,0 +1,894 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <tuple>
+
+#include "ir.hpp"
+#include "frames.hpp"
+
+namespace intcode {
+
+const int NO_BLOCK = -1;
+const int NOT_COMPILABLE = -2;
+
+// memory location, a root node (-1 for absolute) and an offset from it
+typedef std::pair<int, long> MemoryKey;
+
+/**
+ * Two locations can only be told apart when they share a root, otherwise
+ * they may be the same cell
+ */
+static bool may_alias(const MemoryKey& a, const MemoryKey& b) {
+    return a.first != b.first || a.second == b.second;
+}
+
+/**
+ * Lifts a run of instructions into SSA nodes, folding constants, reusing
+ * equal expressions and forwarding stored values to later loads while
+ * building. Cells covered by code are constant for as long as the block
+ * lives, so loads from them fold too. With a frame window, stores relative
+ * to the base the block was entered with are left unchecked and the range
+ * of offsets they cover is kept so that it can be guarded on entry instead
+ */
+class BlockBuilder {
+public:
+    std::vector<IRNode> nodes;
+    IRStats& stats;
+    const std::vector<long>& tape;
+    const DecodeCache& cache;
+    long start, end;
+    unsigned long naive_operations;
+
+    bool window;
+    long frame_low, frame_high;
+
+    int entry_base;
+    int base_root;
+    long base_offset;
+
+    BlockBuilder(IRStats& stats, const std::vector<long>& tape, const DecodeCache& cache, long start, long end,
+        bool window) : stats(stats), tape(tape), cache(cache), start(start), end(end), naive_operations(0),
+        window(window), frame_low(1), frame_high(0) {
+
+        entry_base = add_node(IRNode(IR_BASE));
+        base_root = entry_base;
+        base_offset = 0;
+    }
+
+    bool is_code(long location) const {
+        return (location >= start && location < end) || cache.is_code(location);
+    }
+
+    bool is_constant(int value) const {
+        return nodes[value].op == IR_CONST;
+    }
+
+    int add_node(const IRNode& node) {
+        nodes.push_back(node);
+        stats.nodes++;
+        return nodes.size() - 1;
+    }
+
+    int constant(long value) {
+        auto key = std::make_tuple(IR_CONST, -1, -1, value);
+        auto found = values.find(key);
+        if(found != values.end()) return found->second;
+
+        int node = add_node(IRNode(IR_CONST, -1, -1, value));
+        values[key] = node;
+        return node;
+    }
+
+    /**
+     * Add an arithmetic node unless it folds to a constant, simplifies to
+     * one of its operands or is already computed
+     */
+    int pure(int op, int a, int b) {
+        if(is_constant(a) && is_constant(b)) {
+            long left = nodes[a].imm, right = nodes[b].imm;
+            stats.folded++;
+            switch(op) {
+                case IR_ADD: return constant(left + right);
+                case IR_MUL: return constant(left * right);
+                case IR_LESS: return constant(left < right);
+                default: return constant(left == right);
+            }
+        }
+
+        // canonical order for commutative ops, any constant operand first
+        if(op == IR_ADD || op == IR_MUL || op == IR_EQUAL) {
+            if(is_constant(b) ? (!is_constant(a) || a > b) : (!is_constant(a) && a > b)) std::swap(a, b);
+        }
+
+        if(is_constant(a) && op != IR_LESS) {
+            long value = nodes[a].imm;
+            if((op == IR_ADD && value == 0) || (op == IR_MUL && value == 1)) {
+                stats.folded++;
+                return b;
+            }
+            if(op == IR_MUL && value == 0) {
+                stats.folded++;
+                return a;
+            }
+        }
+        if(a == b && (op == IR_LESS || op == IR_EQUAL)) {
+            stats.folded++;
+            return constant(op == IR_EQUAL);
+        }
+
+        auto key = std::make_tuple(op, a, b, 0L);
+        auto found = values.find(key);
+        if(found != values.end()) {
+            stats.common++;
+            return found->second;
+        }
+
+        int node = add_node(IRNode(op, a, b));
+        values[key] = node;
+        return node;
+    }
+
+    int load(const MemoryKey& key) {
+        int value;
+        if(known(key, value)) return value;
+
+        value = add_node(IRNode(IR_LOAD, key.first, -1, key.second));
+        memory[key] = value;
+        return value;
+    }
+
+    /**
+     * Get the value of a cell without loading it, when it was stored or
+     * loaded earlier in the block or is code
+     *
+     * @returns false if the cell would have to be loaded
+     */
+    bool known(const MemoryKey& key, int& value) {
+        naive_operations++;
+
+        auto found = memory.find(key);
+        if(found != memory.end()) {
+            stats.forwarded++;
+            value = found->second;
+            return true;
+        }
+
+        if(key.first < 0 && key.second >= 0 && is_code(key.second)) {
+            stats.folded++;
+            value = constant(key.second < (long)tape.size() ? tape[key.second] : 0);
+            memory[key] = value;
+            return true;
+        }
+
+        naive_operations--;
+        return false;
+    }
+
+    /**
+     * Stores to code or through the relative base might change code, these
+     * are checked at run time and record what the machine looks like after
+     * the instruction in case they have to exit the block
+     */
+    void store(const MemoryKey& key, int value, long next_position, unsigned int retired) {
+        naive_operations++;
+
+        IRNode node(IR_STORE, key.first, value, key.second);
+        bool frame = window && key.first == entry_base;
+        node.checked = !frame && (key.first >= 0 || key.second < 0 || is_code(key.second));
+        if(frame) {
+            frame_low = (frame_low > frame_high) ? key.second : std::min(frame_low, key.second);
+            frame_high = std::max(frame_high, key.second);
+        }
+        if(node.checked) {
+            node.next_position = next_position;
+            node.retired = retired;
+            node.base_root = base_root;
+            node.base_offset = base_offset;
+        }
+        add_node(node);
+
+        for(auto it = memory.begin(); it != memory.end();) {
+            if(may_alias(it->first, key)) it = memory.erase(it);
+            else it++;
+        }
+        memory[key] = value;
+    }
+
+    MemoryKey get_location(int mode, long arg) const {
+        if(mode == MODE_RELATIVE) return MemoryKey(base_root, base_offset + arg);
+        return MemoryKey(-1, arg);
+    }
+
+    int read(int mode, long arg) {
+        if(mode == MODE_IMMEDIATE) return constant(arg);
+        return load(get_location(mode, arg));
+    }
+
+    void adjust_base(int value) {
+        naive_operations++;
+
+        if(is_constant(value)) {
+            base_offset += nodes[value].imm;
+        } else {
+            base_root = pure(IR_ADD, get_base(), value);
+            base_offset = 0;
+        }
+    }
+
+    // a node holding the current relative base
+    int get_base(void) {
+        return (base_offset == 0) ? base_root : pure(IR_ADD, base_root, constant(base_offset));
+    }
+
+private:
+    std::map<std::tuple<int, int, int, long>, int> values;
+    std::map<MemoryKey, int> memory;
+};
+
+/**
+ * Walk backwards over the nodes removing stores which are written again
+ * before anything could read them, checked stores may exit the block so
+ * every store before them has to stay
+ */
+static void eliminate_dead_stores(std::vector<IRNode>& nodes, std::vector<bool>& dead, IRStats& stats) {
+    std::vector<MemoryKey> overwritten;
+
+    for(int i = nodes.size() - 1; i >= 0; i--) {
+        const IRNode& node = nodes[i];
+
+        if(node.op == IR_STORE) {
+            MemoryKey key(node.a, node.imm);
+
+            if(node.checked) {
+                overwritten.clear();
+            } else if(std::find(overwritten.begin(), overwritten.end(), key) != overwritten.end()) {
+                dead[i] = true;
+                stats.dead_stores++;
+                continue;
+            }
+            overwritten.push_back(key);
+        } else if(node.op == IR_LOAD) {
+            MemoryKey key(node.a, node.imm);
+            overwritten.erase(std::remove_if(overwritten.begin(), overwritten.end(),
+                [&](const MemoryKey& other) { return may_alias(other, key); }), overwritten.end());
+        }
+    }
+}
+
+/**
+ * Mark every node something observable depends on, all others are dropped
+ */
+static void eliminate_dead_values(const std::vector<IRNode>& nodes, std::vector<bool>& dead,
+    const std::vector<int>& roots, IRStats& stats) {
+
+    std::vector<bool> live(nodes.size(), false);
+    std::vector<int> work(roots);
+
+    for(int i = 0; i < (int)nodes.size(); i++) {
+        int op = nodes[i].op;
+        if(dead[i]) continue;
+        if(op == IR_STORE || op == IR_OUTPUT || op == IR_SET_BASE) work.push_back(i);
+        // a load which may read below zero has to stay to throw as the
+        // original instruction would
+        if(op == IR_LOAD && (nodes[i].a >= 0 || nodes[i].imm < 0)) work.push_back(i);
+    }
+
+    while(!work.empty()) {
+        int i = work.back();
+        work.pop_back();
+        if(i < 0 || live[i]) continue;
+
+        live[i] = true;
+        work.push_back(nodes[i].a);
+        work.push_back(nodes[i].b);
+        if(nodes[i].op == IR_STORE && nodes[i].checked) work.push_back(nodes[i].base_root);
+    }
+
+    for(int i = 0; i < (int)nodes.size(); i++) {
+        if(live[i] || dead[i]) continue;
+        dead[i] = true;
+        if(nodes[i].op != IR_CONST && nodes[i].op != IR_BASE) stats.dead_values++;
+    }
+}
+
+IRRunner::IRRunner(Engine& engine) : engine(engine), generation(engine.cache.generation),
+    window_low(1), window_high(0) {
+
+    FrameAnalysis analysis = analyze_frames(engine.tape);
+    if(!analysis.frames.empty()) {
+        window_low = analysis.low;
+        window_high = analysis.high;
+    }
+
+    long size = FRAME_WINDOW_DEPTH;
+    while(size < MAX_FRAME_WINDOW && size < (window_high - window_low + 1) * FRAME_WINDOW_DEPTH) size *= 2;
+
+    window_mask = size - 1;
+    window.resize(size);
+    for(unsigned long slot = 0; slot < window.size(); slot++) empty_slot(slot);
+}
+
+IRRunner::~IRRunner() {
+    clear();
+}
+
+/**
+ * Build the block starting at the given position, the instructions covered
+ * are found first so that stores into the block itself are known to be
+ * stores into code while lifting
+ *
+ * @param position first instruction
+ * @param window if stores into the entry frame may skip the code check
+ * @returns block index, NOT_COMPILABLE if the block would be empty
+ */
+int IRRunner::compile(long position, bool window) {
+    const std::vector<long>& tape = engine.tape;
+    flush();
+
+    std::vector<DecodedInstruction> instructions;
+    std::vector<long> positions;
+    long end = position;
+    bool ends_in_jump = false;
+
+    while(end < (long)tape.size() && (int)instructions.size() < MAX_BLOCK_INSTRUCTIONS) {
+        DecodedInstruction instruction = decode_instruction(tape, end);
+        unsigned int opcode = instruction.opcode;
+
+        if(opcode == OP_INPUT || opcode == OP_HALT || get_operand_count(opcode) == 0) break;
+        if(instruction.modes[0] > MODE_RELATIVE || instruction.modes[1] > MODE_RELATIVE ||
+            instruction.modes[2] > MODE_RELATIVE) break;
+
+        instructions.push_back(instruction);
+        positions.push_back(end);
+        end += instruction.length;
+
+        if(opcode == OP_JUMP_TRUE || opcode == OP_JUMP_FALSE) {
+            ends_in_jump = true;
+            break;
+        }
+    }
+
+    if(instructions.empty()) return NOT_COMPILABLE;
+
+    BlockBuilder builder(stats, tape, engine.cache, position, end, window);
+
+    IRBlock block;
+    block.position = position;
+    block.end = end;
+    block.retired = instructions.size();
+    block.exit_kind = EXIT_JUMP;
+    block.exit_position = end;
+    block.condition = -1;
+    block.jump_on_true = false;
+    block.target_root = -1;
+    block.target_offset = -1;
+    block.fallback = NO_BLOCK;
+    block.valid = true;
+
+    for(size_t i = 0; i < instructions.size(); i++) {
+        const DecodedInstruction& instruction = instructions[i];
+        const int* modes = instruction.modes;
+        const long* args = instruction.args;
+        long next_position = positions[i] + instruction.length;
+
+        switch(instruction.opcode) {
+            case OP_ADD:
+            case OP_MULTI:
+            case OP_LESS_THAN:
+            case OP_EQUALS: {
+                static const int ops[] = { 0, IR_ADD, IR_MUL, 0, 0, 0, 0, IR_LESS, IR_EQUAL };
+                int left = builder.read(modes[0], args[0]);
+                int right = builder.read(modes[1], args[1]);
+                builder.naive_operations++;
+                int value = builder.pure(ops[instruction.opcode], left, right);
+                builder.store(builder.get_location(modes[2] == MODE_RELATIVE ? MODE_RELATIVE : MODE_ADDRESS, args[2]),
+                    value, next_position, i + 1);
+                break;
+            }
+            case OP_OUTPUT:
+                builder.naive_operations++;
+                builder.add_node(IRNode(IR_OUTPUT, builder.read(modes[0], args[0])));
+                break;
+            case OP_ADJUST_BASE:
+                builder.adjust_base(builder.read(modes[0], args[0]));
+                break;
+            case OP_JUMP_TRUE:
+            case OP_JUMP_FALSE: {
+                builder.naive_operations++;
+                int condition = builder.read(modes[0], args[0]);
+                bool jump_on_true = instruction.opcode == OP_JUMP_TRUE;
+
+                // the target is only read when the jump is taken, a target
+                // cell which is not already known is loaded on the exit
+                int target = -1;
+                if(modes[1] == MODE_IMMEDIATE) {
+                    target = builder.constant(args[1]);
+                } else {
+                    MemoryKey key = builder.get_location(modes[1], args[1]);
+                    if(!builder.known(key, target)) {
+                        builder.naive_operations++;
+                        block.target_root = key.first;
+                        block.target_offset = key.second;
+                    }
+                }
+
+                if(builder.is_constant(condition)) {
+                    bool taken = (builder.nodes[condition].imm != 0) == jump_on_true;
+                    if(!taken) {
+                        target = builder.constant(next_position);
+                        block.target_root = -1;
+                        block.target_offset = -1;
+                    }
+                    block.target = target;
+                } else {
+                    block.exit_kind = EXIT_BRANCH;
+                    block.condition = condition;
+                    block.jump_on_true = jump_on_true;
+                    block.target = target;
+                }
+                break;
+            }
+        }
+    }
+
+    if(!ends_in_jump) block.target = builder.constant(end);
+
+    if(builder.base_root != builder.entry_base || builder.base_offset != 0) {
+        builder.add_node(IRNode(IR_SET_BASE, builder.get_base()));
+    }
+
+    std::vector<IRNode>& nodes = builder.nodes;
+    std::vector<bool> dead(nodes.size(), false);
+    eliminate_dead_stores(nodes, dead, stats);
+    eliminate_dead_values(nodes, dead, {block.condition, block.target, block.target_root}, stats);
+
+    // lower what is left, each node's value lives in the register of the
+    // same number
+    block.registers.assign(nodes.size(), 0);
+    block.base_register = dead[builder.entry_base] ? -1 : builder.entry_base;
+    block.naive_operations = builder.naive_operations;
+    block.windowed = builder.frame_low <= builder.frame_high;
+    block.frame_low = builder.frame_low;
+    block.frame_high = builder.frame_high;
+
+    std::vector<long> static_targets;
+
+    // frame stores are held back and written at the end of the block, or
+    // before anything which could see the cell or leave the block early
+    std::vector<IRInstruction> deferred;
+    auto write_back = [&](void) {
+        block.code.insert(block.code.end(), deferred.begin(), deferred.end());
+        deferred.clear();
+    };
+
+    for(int i = 0; i < (int)nodes.size(); i++) {
+        if(dead[i]) continue;
+        const IRNode& node = nodes[i];
+
+        IRInstruction instruction = { 0, i, node.a, node.b, node.imm, 0, 0, -1, 0 };
+        // entry frame cells the frame window covers, only unchecked in a
+        // windowed build
+        bool held = window && node.a == builder.entry_base && node.imm >= window_low && node.imm <= window_high;
+
+        if(!deferred.empty()) {
+            // a frame load at or above frame_low cannot throw while the window
+            // fits, and only sees a deferred store through the same offset
+            bool frame_load = node.op == IR_LOAD && node.a == builder.entry_base && node.imm >= block.frame_low &&
+                std::none_of(deferred.begin(), deferred.end(),
+                    [&](const IRInstruction& store) { return store.imm == node.imm; });
+            // a held store past the end of the tape grows it right away, so
+            // earlier stores go first
+            bool frame_store = node.op == IR_STORE && !node.checked && node.a >= 0 && !held;
+
+            if((node.op == IR_LOAD && !frame_load) || (node.op == IR_STORE && !frame_store)) write_back();
+        }
+
+        switch(node.op) {
+            case IR_CONST:
+                block.registers[i] = node.imm;
+                continue;
+            case IR_BASE:
+                continue;
+            case IR_LOAD:
+                if(held) {
+                    instruction.op = BC_LOAD_FRAME;
+                    break;
+                }
+                instruction.op = (node.a < 0) ? BC_LOAD_ABS : BC_LOAD_REL;
+                break;
+            case IR_STORE:
+                if(node.checked) {
+                    instruction.op = BC_STORE_CHECKED;
+                    instruction.next_position = node.next_position;
+                    instruction.retired = node.retired;
+                    instruction.base_register = node.base_root;
+                    instruction.base_offset = node.base_offset;
+                } else if(held) {
+                    instruction.op = BC_STORE_FRAME;
+                    stats.frame_stores++;
+                } else if(node.a >= 0) {
+                    instruction.op = BC_STORE_REL;
+                    stats.frame_stores++;
+                    deferred.push_back(instruction);
+                    continue;
+                } else {
+                    instruction.op = BC_STORE_ABS;
+                    static_targets.push_back(node.imm);
+                }
+                break;
+            case IR_ADD: instruction.op = BC_ADD; break;
+            case IR_MUL: instruction.op = BC_MUL; break;
+            case IR_LESS: instruction.op = BC_LESS; break;
+            case IR_EQUAL: instruction.op = BC_EQUAL; break;
+            case IR_OUTPUT: instruction.op = BC_OUTPUT; break;
+            case IR_SET_BASE: instruction.op = BC_SET_BASE; break;
+        }
+
+        block.code.push_back(instruction);
+    }
+    write_back();
+
+    stats.lowered += block.code.size();
+    stats.blocks++;
+    if(block.windowed) stats.windowed++;
+
+    // blocks built earlier which write into these cells without checking
+    // now write into code
+    drop_writers(position, end);
+
+    int index = blocks.size();
+    blocks.push_back(block);
+
+    if(end > (long)code_cells.size()) code_cells.resize(end, 0);
+    for(long i = position; i < end; i++) {
+        if(code_cells[i]++ == 0) engine.cache.cover(i, i + 1, 1);
+    }
+    for(long target : static_targets) static_writers[target].push_back(index);
+
+    return index;
+}
+
+/**
+ * Drop every block with an unchecked store into the given cells
+ */
+void IRRunner::drop_writers(long first, long end) {
+    if(static_writers.empty()) return;
+
+    for(long i = first; i < end; i++) {
+        auto writers = static_writers.find(i);
+        if(writers == static_writers.end()) continue;
+
+        for(int index : writers->second) drop_block(index);
+        static_writers.erase(writers);
+    }
+}
+
+/**
+ * The interpreter decoded an instruction, blocks storing into it unchecked
+ * now store into code
+ */
+void IRRunner::watch_decoded(long position) {
+    if(!engine.cache.has_entry(position)) return;
+    drop_writers(position, position + engine.cache.entries[position].length);
+}
+
+void IRRunner::drop_block(int index) {
+    IRBlock& block = blocks[index];
+    if(!block.valid) return;
+
+    block.valid = false;
+    if(block_at[block.position] == index) block_at[block.position] = NO_BLOCK;
+    if(block.fallback >= 0) drop_block(block.fallback);
+
+    for(long i = block.position; i < block.end; i++) {
+        if(--code_cells[i] == 0) engine.cache.cover(i, i + 1, -1);
+    }
+}
+
+/**
+ * Throw away every block
+ */
+void IRRunner::clear(void) {
+    flush();
+    for(int i = 0; i < (int)blocks.size(); i++) drop_block(i);
+
+    blocks.clear();
+    block_at.clear();
+    static_writers.clear();
+    code_cells.clear();
+    generation = engine.cache.generation;
+}
+
+/**
+ * Find or build the block starting at the given position
+ *
+ * @returns block index, negative if the interpreter has to run it
+ */
+int IRRunner::get_block(long position) {
+    if(position < 0 || position >= (long)engine.tape.size()) return NO_BLOCK;
+    if(position >= (long)block_at.size()) block_at.resize(engine.tape.size(), NO_BLOCK);
+
+    int index = block_at[position];
+    if(index == NO_BLOCK) {
+        index = compile(position, true);
+        block_at[position] = index;
+    }
+
+    return index;
+}
+
+/**
+ * Check the cells a block's frame stores reach are not code, every code cell
+ * lies below the end of the decode cache
+ *
+ * @param block windowed block
+ * @returns true if the block can run with unchecked frame stores
+ */
+bool IRRunner::window_fits(const IRBlock& block) const {
+    return engine.relative_base + block.frame_low >= (long)engine.cache.entries.size();
+}
+
+/**
+ * Run a block to its end, or up to a checked store which wrote into code
+ *
+ * @returns false if the block exited early, every block then has to go
+ */
+bool IRRunner::execute(IRBlock& block) {
+    long* registers = block.registers.data();
+
+    if(block.base_register >= 0) registers[block.base_register] = engine.relative_base;
+
+    stats.block_runs++;
+    stats.operations += block.code.size();
+
+    for(const IRInstruction& instruction : block.code) {
+        switch(instruction.op) {
+            case BC_LOAD_ABS:
+                registers[instruction.dst] = load(instruction.imm);
+                break;
+            case BC_LOAD_REL:
+                registers[instruction.dst] = load(registers[instruction.a] + instruction.imm);
+                break;
+            case BC_STORE_ABS:
+                store(instruction.imm, registers[instruction.b]);
+                break;
+            case BC_STORE_REL:
+                store(registers[instruction.a] + instruction.imm, registers[instruction.b]);
+                break;
+            case BC_STORE_CHECKED: {
+                long location = instruction.imm + ((instruction.a < 0) ? 0 : registers[instruction.a]);
+                engine.store(location, registers[instruction.b]);
+                long* held = get_held(location);
+                if(held != nullptr) *held = registers[instruction.b];
+
+                if(engine.cache.generation != generation) {
+                    engine.relative_base = registers[instruction.base_register] + instruction.base_offset;
+                    engine.position = instruction.next_position;
+                    engine.steps += instruction.retired;
+                    stats.retired += instruction.retired;
+                    stats.deopts++;
+                    return false;
+                }
+                break;
+            }
+            case BC_LOAD_FRAME:
+                registers[instruction.dst] = hold(registers[instruction.a] + instruction.imm, false);
+                break;
+            case BC_STORE_FRAME: {
+                // the engine grows the tape, in the same order as the original
+                // stores would have
+                long location = registers[instruction.a] + instruction.imm;
+                if(location < (long)engine.tape.size()) hold(location, true) = registers[instruction.b];
+                else store(location, registers[instruction.b]);
+                break;
+            }
+            case BC_ADD:
+                registers[instruction.dst] = registers[instruction.a] + registers[instruction.b];
+                break;
+            case BC_MUL:
+                registers[instruction.dst] = registers[instruction.a] * registers[instruction.b];
+                break;
+            case BC_LESS:
+                registers[instruction.dst] = registers[instruction.a] < registers[instruction.b];
+                break;
+            case BC_EQUAL:
+                registers[instruction.dst] = registers[instruction.a] == registers[instruction.b];
+                break;
+            case BC_OUTPUT:
+                engine.output.push_back(registers[instruction.a]);
+                break;
+            case BC_SET_BASE:
+                engine.relative_base = registers[instruction.a];
+                break;
+        }
+    }
+
+    long next_position;
+    if(block.exit_kind == EXIT_BRANCH && (registers[block.condition] != 0) != block.jump_on_true) {
+        next_position = block.exit_position;
+    } else if(block.target < 0) {
+        next_position = load(block.target_offset + ((block.target_root < 0) ? 0 : registers[block.target_root]));
+    } else {
+        next_position = registers[block.target];
+    }
+    if(next_position < 0) {
+        throw std::runtime_error("Attempted to jump to out of bounds address " + std::to_string(next_position));
+    }
+
+    engine.position = next_position;
+    engine.steps += block.retired;
+    stats.retired += block.retired;
+    stats.naive_operations += block.naive_operations;
+
+    return true;
+}
+
+/**
+ * Run the block at the current position, building it first if needed
+ *
+ * @returns false if no block can be built there, nothing was run
+ */
+bool IRRunner::run_block(void) {
+    if(engine.cache.generation != generation) clear();
+
+    long position = engine.position;
+    int index = (stats.deopts < MAX_IR_DEOPTS) ? get_block(position) : NO_BLOCK;
+    if(index < 0) return false;
+
+    // frame stores are unchecked, which only holds while every cell they
+    // can reach lies above all code
+    if(blocks[index].windowed && !window_fits(blocks[index])) {
+        stats.window_misses++;
+        if(blocks[index].fallback == NO_BLOCK) {
+            int fallback = compile(position, false);
+            blocks[index].fallback = fallback;
+        }
+        index = blocks[index].fallback;
+    }
+
+    // a throwing instruction leaves the tape as the engine would have, with
+    // every store before it written
+    bool finished;
+    try {
+        finished = execute(blocks[index]);
+    } catch(...) {
+        flush();
+        throw;
+    }
+    if(!finished) clear();
+
+    return true;
+}
+
+/**
+ * Put a frame cell into its window slot, writing back whichever cell held
+ * the slot before. Only cells above code are stored to through the window
+ *
+ * @param location frame cell
+ * @param write if the cell is about to be stored to, else it is read in
+ * @returns the slot now holding the cell
+ */
+FrameCell& IRRunner::fill(long location, bool write) {
+    unsigned long slot = location & window_mask;
+    // read first, a load below zero throws with the window untouched
+    long value = write ? 0 : engine.load(location);
+    FrameCell& cell = window[slot];
+
+    if(cell.location == ~(long)slot) window_used.push_back(slot);
+    else if(cell.dirty) write_back(cell);
+
+    cell.location = location;
+    cell.value = value;
+    cell.dirty = write;
+    stats.frame_fills++;
+
+    return cell;
+}
+
+/**
+ * Write a frame cell leaving the window to the tape
+ */
+void IRRunner::write_back(const FrameCell& cell) {
+    if(cell.location < (long)engine.tape.size()) engine.tape[cell.location] = cell.value;
+    else engine.store(cell.location, cell.value);
+    stats.frame_writes++;
+}
+
+/**
+ * Mark a slot empty, the complement of a slot number never maps to the same
+ * slot while the window has more than one
+ */
+void IRRunner::empty_slot(unsigned long slot) {
+    window[slot].location = ~(long)slot;
+    window[slot].dirty = false;
+}
+
+/**
+ * Write every frame cell changed in the window to the tape and empty it, the
+ * tape is then up to date for anything reading it besides the blocks
+ */
+void IRRunner::flush(void) {
+    for(int slot : window_used) {
+        if(window[slot].dirty) write_back(window[slot]);
+        empty_slot(slot);
+    }
+    window_used.clear();
+}
+
+/**
+ * Run a single instruction on the engine, any code it decodes is watched for
+ * unchecked stores from blocks
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int IRRunner::interpret(void) {
+    long position = engine.position;
+
+    flush();
+    stats.interpreted++;
+    unsigned int reason = engine.step();
+    watch_decoded(position);
+
+    return reason;
+}
+
+/**
+ * Run one block, or one instruction on the interpreter if there is no block
+ * for the current position
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int IRRunner::step(void) {
+    return run_block() ? (unsigned int)PROGRAM_RUNNING : interpret();
+}
+
+/**
+ * Run until the program stops, can be called again after more input is
+ * pushed to resume
+ *
+ * @returns reason execution stopped
+ */
+unsigned int IRRunner::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+/**
+ * Print what the passes removed while building and how many operations the
+ * blocks ran against a direct translation of the same instructions
+ *
+ * @param out stream to write to
+ */
+void IRStats::print(std::ostream& out) const {
+    char buffer[96];
+    auto line = [&](const char* name, unsigned long value) {
+        snprintf(buffer, sizeof(buffer), "%-22s %12lu", name, value);
+        out << buffer << std::endl;
+    };
+
+    line("BLOCKS", blocks);
+    line("NODES LIFTED", nodes);
+    line("FOLDED", folded);
+    line("COMMON SUBEXPRESSIONS", common);
+    line("FORWARDED LOADS", forwarded);
+    line("DEAD STORES", dead_stores);
+    line("DEAD VALUES", dead_values);
+    line("BYTECODE LOWERED", lowered);
+    line("WINDOWED BLOCKS", windowed);
+    line("FRAME STORES", frame_stores);
+    line("WINDOW MISSES", window_misses);
+    line("FRAME CELLS FILLED", frame_fills);
+    line("FRAME WRITE BACKS", frame_writes);
+    line("BLOCK RUNS", block_runs);
+    line("RETIRED IN BLOCKS", retired);
+    line("NAIVE OPERATIONS", naive_operations);
+    line("BYTECODE EXECUTED", operations);
+    line("INTERPRETED", interpreted);
+    line("DEOPTS", deopts);
+}
+
+}
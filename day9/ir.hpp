@@ -0,0 +1,282 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // operations of the block level SSA form, every node defines at most one
+    // value which is never redefined
+    enum {
+        IR_CONST,
+        // relative base on entry to the block
+        IR_BASE,
+        IR_LOAD,
+        IR_STORE,
+        IR_ADD,
+        IR_MUL,
+        IR_LESS,
+        IR_EQUAL,
+        IR_OUTPUT,
+        IR_SET_BASE
+    };
+
+    // register bytecode the optimized nodes are lowered to
+    enum {
+        BC_LOAD_ABS,
+        BC_LOAD_REL,
+        BC_STORE_ABS,
+        // store into the frame the block was entered with, never code, moved
+        // to the end of the block or before the first access which may see it
+        BC_STORE_REL,
+        BC_STORE_CHECKED,
+        // entry frame cells inside the frame offsets, held in the runner's
+        // frame window
+        BC_LOAD_FRAME,
+        BC_STORE_FRAME,
+        BC_ADD,
+        BC_MUL,
+        BC_LESS,
+        BC_EQUAL,
+        BC_OUTPUT,
+        BC_SET_BASE
+    };
+
+    // how a block ends, the next block is looked up from where it continues
+    enum {
+        // continue at the target
+        EXIT_JUMP,
+        // continue at target if condition is (non) zero, else at exit_position
+        EXIT_BRANCH
+    };
+
+    // the most original instructions lifted into a single block
+    const int MAX_BLOCK_INSTRUCTIONS = 64;
+    // blocks are no longer compiled after this many deopts
+    const unsigned long MAX_IR_DEOPTS = 64;
+    // frames of the widest analyzed size the frame window holds at once,
+    // and the most cells it holds, both powers of two
+    const long FRAME_WINDOW_DEPTH = 16;
+    const long MAX_FRAME_WINDOW = 1024;
+
+    /**
+     * A node of the SSA form, a and b are the node indices of its operands.
+     * Memory is addressed by a root node and an offset, a root of -1 is an
+     * absolute address and otherwise the root is a relative base value
+     */
+    class IRNode {
+    public:
+        int op;
+        int a, b;
+        long imm;
+        // stores which may land in code exit the block right after writing,
+        // leaving the machine as it would be after the original instruction
+        bool checked;
+        long next_position;
+        unsigned int retired;
+        int base_root;
+        long base_offset;
+
+        IRNode(int op, int a = -1, int b = -1, long imm = 0) : op(op), a(a), b(b), imm(imm),
+            checked(false), next_position(0), retired(0), base_root(-1), base_offset(0) {}
+    };
+
+    /**
+     * A lowered instruction, operands and destination are registers which
+     * hold a single SSA value each
+     */
+    class IRInstruction {
+    public:
+        int op;
+        int dst, a, b;
+        long imm;
+        // side exit state for BC_STORE_CHECKED
+        long next_position;
+        unsigned int retired;
+        int base_register;
+        long base_offset;
+    };
+
+    /**
+     * A compiled straight line run of original instructions starting at
+     * position, ending in a jump or before an instruction the interpreter has
+     * to handle (input, halt)
+     */
+    class IRBlock {
+    public:
+        long position;
+        long end;
+        // original instructions retired by running the block to its end
+        unsigned int retired;
+        std::vector<IRInstruction> code;
+        // constants are written once when the block is built and never again
+        std::vector<long> registers;
+        // register loaded with the relative base on entry, -1 if unused
+        int base_register;
+
+        int exit_kind;
+        long exit_position;
+        int condition;
+        bool jump_on_true;
+        // register holding the target, or -1 when the target is a cell which
+        // is only read once the jump is known to be taken
+        int target;
+        int target_root;
+        long target_offset;
+        // loads, stores and arithmetic a direct translation would run
+        unsigned long naive_operations;
+
+        // stores relative to the entry base cover these offsets unchecked,
+        // the block only runs while they are all above code
+        bool windowed;
+        long frame_low, frame_high;
+        // same instructions with every frame store checked, for entries where
+        // the frame overlaps code
+        int fallback;
+        bool valid;
+    };
+
+    /**
+     * Counts for what the passes removed and what actually ran
+     */
+    class IRStats {
+    public:
+        unsigned long blocks;
+        unsigned long nodes;
+        unsigned long folded;
+        unsigned long common;
+        unsigned long forwarded;
+        unsigned long dead_stores;
+        unsigned long dead_values;
+        unsigned long lowered;
+        unsigned long windowed;
+        unsigned long frame_stores;
+        unsigned long window_misses;
+        // frame cells read into the frame window, and written back to the
+        // tape when evicted or flushed
+        unsigned long frame_fills;
+        unsigned long frame_writes;
+        // original instructions retired inside blocks, the operations a direct
+        // translation would have run for them and the bytecode actually run
+        unsigned long block_runs;
+        unsigned long retired;
+        unsigned long naive_operations;
+        unsigned long operations;
+        unsigned long interpreted;
+        unsigned long deopts;
+
+        IRStats() : blocks(0), nodes(0), folded(0), common(0), forwarded(0), dead_stores(0),
+            dead_values(0), lowered(0), windowed(0), frame_stores(0), window_misses(0), frame_fills(0),
+            frame_writes(0), block_runs(0), retired(0), naive_operations(0), operations(0), interpreted(0),
+            deopts(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * A slot of the frame window, an empty slot holds a location which can
+     * never map to it
+     */
+    class FrameCell {
+    public:
+        long location;
+        long value;
+        bool dirty;
+    };
+
+    /**
+     * Runs an engine through compiled blocks, falling back to the engine's own
+     * step for instructions blocks stop at. Any write into code cells throws
+     * away every block, they are built again on next entry.
+     *
+     * Frame cells in the offset range found by analyze_frames are kept in a
+     * window of slots across blocks and calls, and are only written to the
+     * tape when another cell takes their slot, before the interpreter or
+     * compiler reads the tape, or on flush. Every other block access checks
+     * the window so aliases see it
+     */
+    class IRRunner {
+    public:
+        Engine& engine;
+        IRStats stats;
+
+        IRRunner(Engine& engine);
+        ~IRRunner();
+
+        unsigned int run(void);
+        unsigned int step(void);
+        bool run_block(void);
+        unsigned int interpret(void);
+        void flush(void);
+        void clear(void);
+
+    private:
+        std::vector<IRBlock> blocks;
+        // block index starting at each position, NO_BLOCK if not built yet and
+        // NOT_COMPILABLE if the interpreter always has to handle it
+        std::vector<int> block_at;
+        // absolute cells written by unchecked stores, and the blocks doing so
+        std::unordered_map<long, std::vector<int>> static_writers;
+        // cells covered by blocks, shared into the engine's code coverage so
+        // that any write to them is noticed
+        std::vector<int> code_cells;
+        unsigned long generation;
+
+        // relative offsets held in the window, none when the program has no
+        // frames, and slots found by the low bits of a cell's location
+        long window_low, window_high;
+        unsigned long window_mask;
+        std::vector<FrameCell> window;
+        // slots which are not empty
+        std::vector<int> window_used;
+
+        int get_block(long position);
+        int compile(long position, bool window);
+        bool window_fits(const IRBlock& block) const;
+        void watch_decoded(long position);
+        void drop_writers(long first, long end);
+        void drop_block(int index);
+        bool execute(IRBlock& block);
+        FrameCell& fill(long location, bool write);
+        void write_back(const FrameCell& cell);
+        void empty_slot(unsigned long slot);
+
+        // the window slot holding a cell, null if the cell is not held
+        long* get_held(long location) {
+            FrameCell& cell = window[location & window_mask];
+            return (cell.location == location) ? &cell.value : nullptr;
+        }
+
+        // the window slot for a frame cell, write if it is about to be stored
+        // to rather than read
+        long& hold(long location, bool write) {
+            FrameCell& cell = window[location & window_mask];
+            if(cell.location != location) return fill(location, write).value;
+
+            cell.dirty |= write;
+            return cell.value;
+        }
+
+        // read a cell for a block, the window may hold a newer value
+        long load(long location) {
+            long* held = get_held(location);
+            return (held != nullptr) ? *held : engine.load(location);
+        }
+
+        // write a cell for an unchecked store, which never lands in code,
+        // keeping a copy the window holds the same
+        void store(long location, long value) {
+            long* held = get_held(location);
+            if(held != nullptr) *held = value;
+
+            if(location < (long)engine.tape.size()) engine.tape[location] = value;
+            else engine.store(location, value);
+        }
+    };
+
+}
+
+#endif // !IR_HPP
@@ -0,0 +1,390 @@
+#include <climits>
+#include <map>
+
+#include "loops.hpp"
+
+namespace intcode {
+
+// the cell an operand reads or writes, immediate writes are address writes
+typedef std::pair<int, long> CellKey;
+
+static CellKey get_key(int mode, long arg) {
+    return CellKey((mode == MODE_RELATIVE) ? MODE_RELATIVE : MODE_ADDRESS, arg);
+}
+
+static bool is_arithmetic(unsigned int opcode) {
+    return opcode == OP_ADD || opcode == OP_MULTI || opcode == OP_LESS_THAN || opcode == OP_EQUALS;
+}
+
+/**
+ * Returns if an instruction adds a non zero constant to the cell it writes
+ *
+ * @param instruction decoded instruction
+ * @param step set to the constant
+ * @returns true if it is a counter update
+ */
+static bool is_counter_update(const DecodedInstruction& instruction, long& step) {
+    if(instruction.opcode != OP_ADD) return false;
+
+    CellKey target = get_key(instruction.modes[2], instruction.args[2]);
+    for(int i = 0; i < 2; i++) {
+        const int other = 1 - i;
+        if(instruction.modes[i] == MODE_IMMEDIATE || get_key(instruction.modes[i], instruction.args[i]) != target) continue;
+        if(instruction.modes[other] != MODE_IMMEDIATE || instruction.args[other] == 0) continue;
+
+        step = instruction.args[other];
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Try to recognise a counted loop from the instructions of its body and the
+ * jump closing it
+ *
+ * @param body body instructions, in order, without the jump
+ * @param jump jump back to the head
+ * @param loop filled in on success
+ * @returns true if the body is a counted loop
+ */
+static bool analyze_loop(const std::vector<DecodedInstruction>& body, const DecodedInstruction& jump,
+    CountedLoop& loop) {
+
+    std::map<CellKey, size_t> writers;
+    for(size_t i = 0; i < body.size(); i++) {
+        if(!is_arithmetic(body[i].opcode)) return false;
+
+        CellKey target = get_key(body[i].modes[2], body[i].args[2]);
+        if(writers.count(target)) return false;
+        writers[target] = i;
+    }
+
+    auto is_invariant = [&](int mode, long arg) {
+        return mode == MODE_IMMEDIATE || writers.count(get_key(mode, arg)) == 0;
+    };
+
+    if(jump.modes[0] == MODE_IMMEDIATE) return false;
+    auto tested = writers.find(get_key(jump.modes[0], jump.args[0]));
+    if(tested == writers.end()) return false;
+
+    size_t update, compare = body.size();
+    const DecodedInstruction& test = body[tested->second];
+
+    if(jump.opcode == OP_JUMP_TRUE && is_counter_update(test, loop.step)) {
+        update = tested->second;
+        loop.counter = LoopOperand(test.modes[2], test.args[2]);
+        loop.condition = LOOP_NONZERO;
+        loop.has_flag = false;
+    } else {
+        compare = tested->second;
+        if(test.opcode != OP_LESS_THAN && test.opcode != OP_EQUALS) return false;
+
+        // one side is the counter, the other the limit
+        int side = -1;
+        for(int i = 0; i < 2 && side < 0; i++) {
+            if(test.modes[i] == MODE_IMMEDIATE || !is_invariant(test.modes[1 - i], test.args[1 - i])) continue;
+
+            auto writer = writers.find(get_key(test.modes[i], test.args[i]));
+            if(writer != writers.end() && writer->second < compare && is_counter_update(body[writer->second], loop.step)) {
+                side = i;
+                update = writer->second;
+            }
+        }
+        if(side < 0) return false;
+
+        if(test.opcode == OP_LESS_THAN && jump.opcode == OP_JUMP_TRUE) {
+            loop.condition = (side == 0) ? LOOP_LESS : LOOP_GREATER;
+        } else if(test.opcode == OP_EQUALS && jump.opcode == OP_JUMP_FALSE) {
+            loop.condition = LOOP_NOT_EQUAL;
+        } else {
+            return false;
+        }
+
+        loop.counter = LoopOperand(test.modes[side], test.args[side]);
+        loop.limit = LoopOperand(test.modes[1 - side], test.args[1 - side]);
+        loop.flag = LoopOperand(test.modes[2], test.args[2]);
+        loop.has_flag = true;
+    }
+
+    CellKey counter = get_key(loop.counter.mode, loop.counter.arg);
+
+    for(size_t i = 0; i < body.size(); i++) {
+        if(i == update || i == compare) continue;
+
+        const DecodedInstruction& instruction = body[i];
+        CellKey target = get_key(instruction.modes[2], instruction.args[2]);
+
+        Accumulation accumulation;
+        accumulation.opcode = instruction.opcode;
+        accumulation.target = LoopOperand(instruction.modes[2], instruction.args[2]);
+        accumulation.after_update = i > update;
+
+        bool found = false;
+        if(instruction.opcode == OP_ADD) {
+            for(int j = 0; j < 2 && !found; j++) {
+                int mode = instruction.modes[1 - j];
+                long arg = instruction.args[1 - j];
+                if(instruction.modes[j] == MODE_IMMEDIATE || get_key(instruction.modes[j], instruction.args[j]) != target) {
+                    continue;
+                }
+
+                if(is_invariant(mode, arg)) {
+                    accumulation.kind = ACCUMULATE_INVARIANT;
+                } else if(mode != MODE_IMMEDIATE && get_key(mode, arg) == counter) {
+                    accumulation.kind = ACCUMULATE_COUNTER;
+                } else {
+                    continue;
+                }
+                accumulation.left = LoopOperand(mode, arg);
+                found = true;
+            }
+        }
+
+        if(!found) {
+            if(!is_invariant(instruction.modes[0], instruction.args[0]) ||
+                !is_invariant(instruction.modes[1], instruction.args[1])) {
+
+                return false;
+            }
+            accumulation.kind = ACCUMULATE_STORE;
+            accumulation.left = LoopOperand(instruction.modes[0], instruction.args[0]);
+            accumulation.right = LoopOperand(instruction.modes[1], instruction.args[1]);
+        }
+
+        loop.accumulations.push_back(accumulation);
+    }
+
+    return true;
+}
+
+/**
+ * Find every loop in the program made of a single block closed by a jump back
+ * to its own head, which counts a cell by a constant step towards a limit.
+ * Jumps are found by a linear pass, each body is then decoded again from its
+ * head
+ *
+ * @param tape program tape
+ * @returns recognised loops
+ */
+std::vector<CountedLoop> find_counted_loops(const std::vector<long>& tape) {
+    std::vector<CountedLoop> loops;
+
+    for(long position = 0; position < (long)tape.size();) {
+        DecodedInstruction jump = decode_instruction(tape, position);
+        if(get_operand_count(jump.opcode) == 0) {
+            position++;
+            continue;
+        }
+
+        long head = jump.args[1];
+        bool backward = (jump.opcode == OP_JUMP_TRUE || jump.opcode == OP_JUMP_FALSE) &&
+            jump.modes[1] == MODE_IMMEDIATE && head >= 0 && head < position;
+
+        if(backward) {
+            std::vector<DecodedInstruction> body;
+            long current = head;
+            while(current < position) {
+                DecodedInstruction instruction = decode_instruction(tape, current);
+                if(get_operand_count(instruction.opcode) == 0) break;
+                body.push_back(instruction);
+                current += instruction.length;
+            }
+
+            CountedLoop loop;
+            if(current == position && analyze_loop(body, jump, loop)) {
+                loop.head = head;
+                loop.end = position + jump.length;
+                loop.code.assign(tape.begin() + head, tape.begin() + std::min(loop.end, (long)tape.size()));
+                loop.length = body.size() + 1;
+                loops.push_back(loop);
+            }
+        }
+
+        position += jump.length;
+    }
+
+    return loops;
+}
+
+LoopRunner::LoopRunner(Engine& engine) : engine(engine) {
+    loops = find_counted_loops(engine.tape);
+    for(size_t i = 0; i < loops.size(); i++) loop_at[loops[i].head] = i;
+    stats.loops = loops.size();
+}
+
+/**
+ * Get the amount of iterations a do while loop runs for, the condition is
+ * checked against start + step * j after iteration j
+ *
+ * @returns iterations, 0 if the loop would never end
+ */
+static __int128 get_trip_count(int condition, __int128 start, __int128 step, __int128 limit) {
+    switch(condition) {
+        case LOOP_LESS:
+            if(start + step >= limit) return 1;
+            if(step <= 0) return 0;
+            return (limit - start + step - 1) / step;
+        case LOOP_GREATER:
+            if(start + step <= limit) return 1;
+            if(step >= 0) return 0;
+            return (start - limit + -step - 1) / -step;
+        default: {
+            // LOOP_NONZERO has a limit of 0
+            __int128 distance = limit - start;
+            if(distance % step != 0 || distance / step < 1) return 0;
+            return distance / step;
+        }
+    }
+}
+
+/**
+ * Run the loop at the current position to completion in one go, if the
+ * program still matches it and the cells it touches do not overlap
+ *
+ * @param loop loop starting at the current position
+ * @returns true if the loop was run
+ */
+bool LoopRunner::summarize(const CountedLoop& loop) {
+    std::vector<long>& tape = engine.tape;
+
+    if(loop.end > (long)tape.size() || !std::equal(loop.code.begin(), loop.code.end(), tape.begin() + loop.head)) {
+        stats.rejected++;
+        return false;
+    }
+
+    auto address = [&](const LoopOperand& operand) {
+        return (operand.mode == MODE_RELATIVE) ? engine.relative_base + operand.arg : operand.arg;
+    };
+    auto value = [&](const LoopOperand& operand) {
+        return (operand.mode == MODE_IMMEDIATE) ? operand.arg : engine.load(address(operand));
+    };
+
+    std::vector<long> written = { address(loop.counter) };
+    std::vector<long> read;
+    if(loop.has_flag) written.push_back(address(loop.flag));
+    if(loop.condition != LOOP_NONZERO && loop.limit.mode != MODE_IMMEDIATE) read.push_back(address(loop.limit));
+    for(const Accumulation& accumulation : loop.accumulations) {
+        written.push_back(address(accumulation.target));
+        if(accumulation.kind != ACCUMULATE_COUNTER && accumulation.left.mode != MODE_IMMEDIATE) {
+            read.push_back(address(accumulation.left));
+        }
+        if(accumulation.kind == ACCUMULATE_STORE && accumulation.right.mode != MODE_IMMEDIATE) {
+            read.push_back(address(accumulation.right));
+        }
+    }
+
+    // relative and absolute operands may turn out to be the same cell
+    for(size_t i = 0; i < written.size(); i++) {
+        long location = written[i];
+        bool clash = location < 0 || (location >= loop.head && location < loop.end) || engine.cache.is_code(location);
+        for(size_t j = i + 1; j < written.size() && !clash; j++) clash = written[j] == location;
+        for(size_t j = 0; j < read.size() && !clash; j++) clash = read[j] == location;
+
+        if(clash) {
+            stats.rejected++;
+            return false;
+        }
+    }
+    for(long location : read) {
+        if(location < 0) {
+            stats.rejected++;
+            return false;
+        }
+    }
+
+    __int128 start = value(loop.counter);
+    __int128 step = loop.step;
+    __int128 limit = (loop.condition == LOOP_NONZERO) ? 0 : value(loop.limit);
+    __int128 trips = get_trip_count(loop.condition, start, step, limit);
+
+    // single iterations are left to the engine, as are loops which only end
+    // by overflowing
+    if(trips < 2) return false;
+
+    std::vector<std::pair<long, __int128>> results;
+    results.push_back({ written[0], start + trips * step });
+    if(loop.has_flag) results.push_back({ written[1], loop.condition == LOOP_NOT_EQUAL });
+
+    for(const Accumulation& accumulation : loop.accumulations) {
+        long target = address(accumulation.target);
+        __int128 result;
+
+        switch(accumulation.kind) {
+            case ACCUMULATE_INVARIANT:
+                result = value(accumulation.target) + trips * value(accumulation.left);
+                break;
+            case ACCUMULATE_COUNTER: {
+                // the counter seen is start + step * j for j from 1 to trips
+                // after the update, or from 0 to trips - 1 before it
+                __int128 series = accumulation.after_update ? trips * (trips + 1) / 2 : trips * (trips - 1) / 2;
+                result = value(accumulation.target) + trips * start + step * series;
+                break;
+            }
+            default: {
+                __int128 left = value(accumulation.left), right = value(accumulation.right);
+                switch(accumulation.opcode) {
+                    case OP_ADD: result = left + right; break;
+                    case OP_MULTI: result = left * right; break;
+                    case OP_LESS_THAN: result = left < right; break;
+                    default: result = left == right; break;
+                }
+            }
+        }
+
+        results.push_back({ target, result });
+    }
+
+    __int128 steps = trips * loop.length;
+    for(auto& result : results) {
+        if(result.second < LONG_MIN || result.second > LONG_MAX || steps > LONG_MAX) {
+            stats.rejected++;
+            return false;
+        }
+    }
+
+    for(auto& result : results) engine.store(result.first, (long)result.second);
+
+    engine.position = loop.end;
+    engine.steps += (unsigned long)steps;
+    stats.summarized++;
+    stats.skipped_steps += (unsigned long)steps;
+
+    return true;
+}
+
+/**
+ * Run a whole counted loop if one starts at the current position, otherwise
+ * a single instruction on the engine
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int LoopRunner::step(void) {
+    auto found = loop_at.find(engine.position);
+    if(found != loop_at.end() && summarize(loops[found->second])) return PROGRAM_RUNNING;
+
+    return engine.step();
+}
+
+/**
+ * Run until the program stops, can be called again after more input is
+ * pushed to resume
+ *
+ * @returns reason execution stopped
+ */
+unsigned int LoopRunner::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+void LoopStats::print(std::ostream& out) const {
+    out << "COUNTED LOOPS " << loops << std::endl;
+    out << "SUMMARIZED RUNS " << summarized << std::endl;
+    out << "SKIPPED STEPS " << skipped_steps << std::endl;
+    out << "REJECTED " << rejected << std::endl;
+}
+
+}
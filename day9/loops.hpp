@@ -0,0 +1,121 @@
+#ifndef LOOPS_HPP
+#define LOOPS_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // when a counted loop keeps going, checked after the counter is updated
+    enum {
+        // counter < limit
+        LOOP_LESS,
+        // limit < counter
+        LOOP_GREATER,
+        // counter != 0
+        LOOP_NONZERO,
+        // counter != limit
+        LOOP_NOT_EQUAL
+    };
+
+    // what a body instruction other than the counter update and compare does
+    // to the cell it writes
+    enum {
+        // cell += invariant
+        ACCUMULATE_INVARIANT,
+        // cell += counter
+        ACCUMULATE_COUNTER,
+        // cell = invariant op invariant
+        ACCUMULATE_STORE
+    };
+
+    /**
+     * An operand as it appears in the program, resolved against the relative
+     * base at run time
+     */
+    class LoopOperand {
+    public:
+        int mode;
+        long arg;
+
+        LoopOperand(int mode = MODE_IMMEDIATE, long arg = 0) : mode(mode), arg(arg) {}
+    };
+
+    class Accumulation {
+    public:
+        int kind;
+        unsigned int opcode;
+        LoopOperand target;
+        LoopOperand left, right;
+        // for ACCUMULATE_COUNTER, if the counter was already updated
+        bool after_update;
+    };
+
+    /**
+     * A loop whose body is a single basic block ending in a jump back to its
+     * head, with one counter moving by a constant step every iteration and
+     * every other write an affine accumulation
+     */
+    class CountedLoop {
+    public:
+        long head;
+        long end;
+        // tape contents the loop was recognised from
+        std::vector<long> code;
+        // instructions per iteration, including the jump
+        unsigned long length;
+
+        LoopOperand counter;
+        long step;
+        int condition;
+        LoopOperand limit;
+        // cell the comparison writes, only for LOOP_LESS, LOOP_GREATER and
+        // LOOP_NOT_EQUAL
+        LoopOperand flag;
+        bool has_flag;
+        std::vector<Accumulation> accumulations;
+    };
+
+    std::vector<CountedLoop> find_counted_loops(const std::vector<long>& tape);
+
+    class LoopStats {
+    public:
+        unsigned long loops;
+        unsigned long summarized;
+        unsigned long skipped_steps;
+        unsigned long rejected;
+
+        LoopStats() : loops(0), summarized(0), skipped_steps(0), rejected(0) {}
+
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Runs an engine, replacing every full run of a counted loop with its
+     * closed form whenever the loop head is reached. The preconditions are
+     * checked each time, anything that does not hold leaves the loop to the
+     * engine
+     */
+    class LoopRunner {
+    public:
+        Engine& engine;
+        LoopStats stats;
+
+        LoopRunner(Engine& engine);
+
+        unsigned int step(void);
+        unsigned int run(void);
+
+    private:
+        std::vector<CountedLoop> loops;
+        std::unordered_map<long, size_t> loop_at;
+
+        bool summarize(const CountedLoop& loop);
+    };
+
+}
+
+#endif // !LOOPS_HPP
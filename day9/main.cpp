@@ -1,20 +1,282 @@
+#include <cctype>
+#include <cstring>
+#include <memory>
+
 #include "intcode.hpp"
+#include "engine.hpp"
+#include "ir.hpp"
+#include "closure.hpp"
+#include "frames.hpp"
+#include "tiering.hpp"
+#include "cycles.hpp"
+#include "loops.hpp"
+#include "specialize.hpp"
+#include "constant.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "replay.hpp"
 
 #define INPUT_LOCATION "./input"
+#define FOLDED_LOCATION "./profile.folded"
+#define TRACE_LOCATION "./day9.trace"
+
+// examples from the puzzle, run entirely while compiling
+constexpr long QUINE[] = { 109, 1, 204, -1, 1001, 100, 1, 100, 1008, 100, 16, 101, 1006, 101, 0, 99 };
+constexpr long LARGE_PRODUCT[] = { 1102, 34915192, 34915192, 7, 4, 7, 99, 0 };
+constexpr long EQUALS_EIGHT[] = { 3, 9, 8, 9, 10, 9, 4, 9, 99, -1, 8 };
+// the target of a jump which is not taken is never read, see untaken_jump_input
+constexpr long UNTAKEN_JUMP[] = { 109, -5, 2005, 8, 0, 104, 42, 99, 0 };
+
+constexpr auto quine = intcode::run_constant(intcode::make_tape<128>(QUINE));
+static_assert(quine.output_count == 16 && quine.output[0] == 109 && quine.output[15] == 99,
+    "quine example does not output itself");
+
+constexpr auto large_product = intcode::run_constant(intcode::make_tape<8>(LARGE_PRODUCT));
+static_assert(large_product.output[0] == 1219070632396864L, "large product example is wrong");
+
+static_assert(intcode::run_constant(intcode::make_tape<11>(EQUALS_EIGHT), {8}).output[0] == 1 &&
+    intcode::run_constant(intcode::make_tape<11>(EQUALS_EIGHT), {7}).output[0] == 0,
+    "equals example is wrong");
+
+static_assert(intcode::run_constant(intcode::make_tape<9>(UNTAKEN_JUMP)).output[0] == 42,
+    "untaken jump read its target");
 
 int main(int argc, char** argv) {
 
     std::string input_location = INPUT_LOCATION;
+    bool use_engine = false;
+    bool use_ir = false;
+    bool use_closures = false;
+    bool detect_cycles = false;
+    bool summarize_loops = false;
+    bool use_specializer = false;
+    bool show_constants = false;
+    bool show_frames = false;
+    bool use_tiering = false;
+    unsigned long thresholds[2] = { 64, 256 };
+    bool use_profiler = false;
+    bool use_tracer = false;
+    bool use_recorder = false;
+    unsigned long replay_step = 0;
+    long back_to = -1;
 
-    if(argc > 1) input_location = argv[1];
+    for(int i = 1; i < argc; i++) {
+        // run on the decode cache engine and report what the peephole pass did
+        if(strcmp(argv[i], "--fast") == 0) use_engine = true;
+        // run through blocks lifted to SSA and optimized, see ir.hpp
+        else if(strcmp(argv[i], "--ir") == 0) use_ir = true;
+        // run through chains of pre-bound handlers, see closure.hpp
+        else if(strcmp(argv[i], "--closure") == 0) use_closures = true;
+        // stop on hangs and skip over linear loops, see cycles.hpp
+        else if(strcmp(argv[i], "--detect") == 0) detect_cycles = true;
+        // run counted loops in one go from their closed form, see loops.hpp
+        else if(strcmp(argv[i], "--loops") == 0) summarize_loops = true;
+        // fold everything before the first input once, then run both parts
+        // from the residual state
+        else if(strcmp(argv[i], "--specialize") == 0) use_specializer = true;
+        // print the examples evaluated at compile time, see constant.hpp
+        else if(strcmp(argv[i], "--constant") == 0) show_constants = true;
+        // list functions and calls found by their relative base patterns
+        else if(strcmp(argv[i], "--frames") == 0) show_frames = true;
+        // start on run_program and promote hot blocks, optionally followed by
+        // the engine and IR thresholds
+        else if(strcmp(argv[i], "--tiered") == 0) {
+            use_tiering = true;
+            for(int j = 0; j < 2 && i + 1 < argc && isdigit(argv[i + 1][0]); j++) {
+                thresholds[j] = std::stoul(argv[++i]);
+            }
+        }
+        // count executions per position and time blocks, see profiler.hpp
+        else if(strcmp(argv[i], "--profile") == 0) use_profiler = true;
+        // record every instruction to a trace file, read with intcode-trace
+        else if(strcmp(argv[i], "--trace") == 0) use_tracer = true;
+        // run to the end while taking snapshots, then go back to the given
+        // step and show the machine there, see replay.hpp
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            use_recorder = true;
+            replay_step = std::stoul(argv[++i]);
+        }
+        // same, going back to the last time the given position was next
+        else if(strcmp(argv[i], "--back-to") == 0 && i + 1 < argc) {
+            use_recorder = true;
+            back_to = std::stol(argv[++i]);
+        }
+        else input_location = argv[i];
+    }
+
+    if(show_constants) {
+        std::cout << "QUINE ";
+        for(size_t i = 0; i < quine.output_count; i++) std::cout << quine.output[i] << " ";
+        std::cout << "STEPS " << quine.steps << std::endl;
+        std::cout << "LARGE PRODUCT " << large_product.output[0] << std::endl;
+
+        return 0;
+    }
 
     std::vector<long> opcodes = intcode::get_opcodes_from_file(input_location);
 
-    intcode::RunState state = intcode::run_program(opcodes, {2L});
+    if(use_engine) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        engine.run();
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        std::cout << "STEPS " << engine.steps << std::endl;
+        engine.stats.print(std::cout);
+
+        return 0;
+    }
+
+    if(show_frames) {
+        intcode::analyze_frames(opcodes).print(std::cout);
+        return 0;
+    }
+
+    if(use_ir) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        intcode::IRRunner runner(engine);
+        runner.run();
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        std::cout << "STEPS " << engine.steps << std::endl;
+        runner.stats.print(std::cout);
+
+        return 0;
+    }
+
+    if(detect_cycles) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        intcode::CycleDetector detector(engine);
+        unsigned int reason = detector.run();
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        if(reason == intcode::PROGRAM_HANG) std::cout << "HANG AT " << engine.position << std::endl;
+        std::cout << "STEPS " << engine.steps << std::endl;
+        detector.stats.print(std::cout);
+
+        return 0;
+    }
+
+    if(use_specializer) {
+        intcode::Specialization residual = intcode::specialize(opcodes, {});
+        residual.print(std::cout);
+
+        for(long mode : {1L, 2L}) {
+            std::vector<long> tape;
+            intcode::Engine engine(tape);
+            residual.restore(engine);
+            engine.push_input({mode});
+            engine.run();
+
+            std::cout << "INPUT " << mode << " OUTPUT ";
+            for(auto i : engine.output) std::cout << i << " ";
+            std::cout << "STEPS " << engine.steps << std::endl;
+        }
+
+        return 0;
+    }
+
+    if(summarize_loops) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        intcode::LoopRunner runner(engine);
+        runner.run();
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        std::cout << "STEPS " << engine.steps << std::endl;
+        runner.stats.print(std::cout);
+
+        return 0;
+    }
+
+    if(use_recorder) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        intcode::Recorder recorder(engine);
+        recorder.run();
+        unsigned long total = engine.steps;
+
+        bool reached = (back_to >= 0) ? recorder.run_back_to(back_to) : recorder.seek(replay_step);
+        if(!reached) {
+            std::cout << "NOT REACHED IN " << total << " STEPS" << std::endl;
+            return -1;
+        }
+
+        std::cout << "STEP " << engine.steps << " OF " << total << std::endl;
+        std::cout << "POSITION " << engine.position << std::endl;
+        std::cout << "RELATIVE BASE " << engine.relative_base << std::endl;
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        std::cout << "SNAPSHOTS " << recorder.snapshots.size() << std::endl;
+
+        return 0;
+    }
+
+    if(use_closures) {
+        intcode::Engine engine(opcodes);
+        engine.push_input({2L});
+        intcode::ClosureRunner runner(engine);
+        runner.run();
+
+        std::cout << "OUTPUT ";
+        for(auto i : engine.output) std::cout << i << " ";
+        std::cout << std::endl;
+
+        std::cout << "STEPS " << engine.steps << std::endl;
+        runner.stats.print(std::cout);
+
+        return 0;
+    }
+
+    intcode::Profiler profiler;
+    intcode::RunOptions options;
+    if(use_profiler) options.profiler = &profiler;
+
+    intcode::Tiering tiering(thresholds[0], thresholds[1], &std::cout);
+    if(use_tiering) options.tiering = &tiering;
+
+    std::unique_ptr<intcode::TraceRecorder> tracer;
+    if(use_tracer) {
+        tracer.reset(new intcode::TraceRecorder(TRACE_LOCATION));
+        options.tracer = tracer.get();
+    }
+
+    intcode::RunState state = intcode::run_program(opcodes, {2L}, intcode::RunState(), options);
 
     std::cout << "OUTPUT ";
     for(auto i : state.output) std::cout << i << " ";
     std::cout << std::endl;
 
+    if(use_tiering) tiering.print(std::cout);
+
+    if(use_profiler) {
+        profiler.print_report(std::cout);
+
+        std::ofstream folded(FOLDED_LOCATION);
+        profiler.write_folded(folded);
+        std::cout << "FOLDED STACKS WRITTEN TO " << FOLDED_LOCATION << std::endl;
+    }
+
+    if(use_tracer) {
+        std::cout << tracer->get_written() << " TRACE RECORDS WRITTEN TO " << TRACE_LOCATION << std::endl;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,219 @@
+#include "engine.hpp"
+
+namespace intcode {
+
+// the most adjust base instructions folded into a single superinstruction,
+// keeps the fused entry within MAX_DECODED_SPAN cells
+const unsigned int MAX_BASE_CHAIN = MAX_DECODED_SPAN / 2;
+
+/**
+ * Write operands treat immediate mode as address mode, normalize so they can
+ * be compared against read operands
+ *
+ * @param mode write parameter mode
+ * @returns normalized mode
+ */
+static int normalize_write_mode(int mode) {
+    return (mode == MODE_RELATIVE) ? MODE_RELATIVE : MODE_ADDRESS;
+}
+
+/**
+ * Returns if reading an operand may throw, such reads cannot be dropped
+ *
+ * @param instruction decoded instruction
+ * @param operand operand index
+ */
+static bool may_fault(const DecodedInstruction& instruction, int operand) {
+    int mode = instruction.modes[operand];
+    return mode == MODE_RELATIVE || (mode == MODE_ADDRESS && instruction.args[operand] < 0);
+}
+
+/**
+ * ADD x, 0, y / ADD 0, x, y / MULT x, 1, y / MULT 1, x, y become MOV x, y,
+ * arithmetic on two immediates or a multiply by an immediate 0 becomes a move
+ * of the resulting constant, unless the dropped read could throw
+ *
+ * @param instruction decoded ADD or MULT, rewritten in place
+ * @returns true if rewritten
+ */
+static bool fuse_move(DecodedInstruction& instruction) {
+    bool left_imm = instruction.modes[0] == MODE_IMMEDIATE;
+    bool right_imm = instruction.modes[1] == MODE_IMMEDIATE;
+    long left = instruction.args[0];
+    long right = instruction.args[1];
+
+    int source = -1;
+    long constant = 0;
+    bool is_constant = false;
+
+    if(instruction.opcode == OP_ADD) {
+        if(left_imm && right_imm) {
+            is_constant = true;
+            constant = left + right;
+        } else if(left_imm && left == 0) {
+            source = 1;
+        } else if(right_imm && right == 0) {
+            source = 0;
+        }
+    } else {
+        if(left_imm && right_imm) {
+            is_constant = true;
+            constant = left * right;
+        } else if((left_imm && left == 0 && !may_fault(instruction, 1)) ||
+            (right_imm && right == 0 && !may_fault(instruction, 0))) {
+            is_constant = true;
+            constant = 0;
+        } else if(left_imm && left == 1) {
+            source = 1;
+        } else if(right_imm && right == 1) {
+            source = 0;
+        }
+    }
+
+    if(is_constant) {
+        instruction.modes[0] = MODE_IMMEDIATE;
+        instruction.args[0] = constant;
+    } else if(source >= 0) {
+        instruction.modes[0] = instruction.modes[source];
+        instruction.args[0] = instruction.args[source];
+    } else {
+        return false;
+    }
+
+    instruction.opcode = SUPER_MOVE;
+    instruction.modes[1] = MODE_IMMEDIATE;
+    instruction.args[1] = 0;
+
+    return true;
+}
+
+/**
+ * LESS_THAN/EQUALS a, b, t followed by JUMP_TRUE/JUMP_FALSE t, L becomes
+ * CMPJMP a, b, t, L, the flag is still written to t since later code may read
+ * it
+ *
+ * @param tape program tape
+ * @param position position of the compare
+ * @param instruction decoded compare, rewritten in place
+ * @returns true if fused
+ */
+static bool fuse_compare_jump(const std::vector<long>& tape, long position,
+    DecodedInstruction& instruction) {
+
+    long next_position = position + instruction.length;
+    if(next_position >= (long)tape.size()) return false;
+
+    DecodedInstruction jump = decode_instruction(tape, next_position);
+    if(jump.opcode != OP_JUMP_TRUE && jump.opcode != OP_JUMP_FALSE) return false;
+
+    // the jump must test exactly the cell the compare wrote to
+    if(jump.modes[0] == MODE_IMMEDIATE) return false;
+    if(jump.modes[0] != normalize_write_mode(instruction.modes[2])) return false;
+    if(jump.args[0] != instruction.args[2]) return false;
+
+    instruction.variant = 0;
+    if(instruction.opcode == OP_EQUALS) instruction.variant |= CMP_EQUALS;
+    if(jump.opcode == OP_JUMP_TRUE) instruction.variant |= JUMP_ON_TRUE;
+
+    instruction.opcode = SUPER_CMP_JUMP;
+    instruction.modes[3] = jump.modes[1];
+    instruction.args[3] = jump.args[1];
+    instruction.length += jump.length;
+    instruction.count += jump.count;
+
+    return true;
+}
+
+/**
+ * A run of ADJUST_BASE instructions with immediate operands becomes a single
+ * adjustment by their sum
+ *
+ * @param tape program tape
+ * @param position position of the first adjustment
+ * @param instruction decoded adjustment, rewritten in place
+ * @returns true if fused
+ */
+static bool fuse_adjust_base(const std::vector<long>& tape, long position,
+    DecodedInstruction& instruction) {
+
+    if(instruction.modes[0] != MODE_IMMEDIATE) return false;
+
+    long total = instruction.args[0];
+    unsigned int count = 1;
+    long next_position = position + instruction.length;
+
+    while(count < MAX_BASE_CHAIN && next_position < (long)tape.size()) {
+        DecodedInstruction next = decode_instruction(tape, next_position);
+        if(next.opcode != OP_ADJUST_BASE || next.modes[0] != MODE_IMMEDIATE) break;
+
+        total += next.args[0];
+        next_position += next.length;
+        count++;
+    }
+
+    if(count < 2) return false;
+
+    instruction.opcode = SUPER_ADJUST_BASE;
+    instruction.args[0] = total;
+    instruction.length = next_position - position;
+    instruction.count = count;
+
+    return true;
+}
+
+/**
+ * Try each peephole rule on a freshly decoded instruction, replacing it with
+ * a superinstruction when one matches
+ *
+ * @param tape program tape
+ * @param position position of instruction
+ * @param instruction decoded instruction, rewritten in place
+ * @param stats stats to count the applied rule in, may be null
+ * @returns true if a rule was applied
+ */
+bool apply_peephole(const std::vector<long>& tape, long position,
+    DecodedInstruction& instruction, PeepholeStats* stats) {
+
+    int rule = -1;
+
+    switch(instruction.opcode) {
+        case OP_ADD:
+        case OP_MULTI:
+            if(fuse_move(instruction)) rule = PeepholeStats::RULE_MOVE;
+            break;
+        case OP_LESS_THAN:
+        case OP_EQUALS:
+            if(fuse_compare_jump(tape, position, instruction)) rule = PeepholeStats::RULE_CMP_JUMP;
+            break;
+        case OP_ADJUST_BASE:
+            if(fuse_adjust_base(tape, position, instruction)) rule = PeepholeStats::RULE_ADJUST_BASE;
+            break;
+    }
+
+    if(rule < 0) return false;
+    if(stats != nullptr) stats->sites[rule]++;
+
+    return true;
+}
+
+/**
+ * Print a per rule report of how often each rule fired and how many
+ * instructions it removed, for moves the removed instructions are the
+ * arithmetic operations replaced by a plain copy
+ *
+ * @param out stream to write to
+ */
+void PeepholeStats::print(std::ostream& out) const {
+    const char* names[RULE_COUNT] = { "MOV", "CMPJMP", "ARB_CHAIN" };
+
+    out << "RULE        SITES      EXECUTED   ELIMINATED" << std::endl;
+    for(int i = 0; i < RULE_COUNT; i++) {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), "%-10s %6lu %13lu %12lu",
+            names[i], sites[i], executed[i], eliminated[i]);
+        out << buffer << std::endl;
+    }
+    out << "DEOPTS : " << deopts << std::endl;
+}
+
+}
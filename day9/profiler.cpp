@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "profiler.hpp"
+#include "intcode.hpp"
+
+namespace intcode {
+
+/**
+ * Read the processor cycle counter, falls back to a nanosecond clock on
+ * platforms without rdtsc
+ *
+ * @returns current cycle count
+ */
+unsigned long long read_cycle_counter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Get the counter index for an instruction's opcode and parameter modes
+ *
+ * @param instruction raw instruction value
+ * @returns index into mode_counts
+ */
+static size_t get_mode_index(long instruction) {
+    if(instruction < 0) return 0;
+
+    size_t opcode = instruction % 100;
+    size_t combination = 0;
+    long modes = instruction / 100;
+    for(int i = 0; i < 3; i++) {
+        combination = combination * 4 + std::min(modes % 10, 3L);
+        modes /= 10;
+    }
+
+    return opcode * Profiler::MODE_COMBINATIONS + combination;
+}
+
+Profiler::Profiler(unsigned int sample_period) :
+    sample_period(sample_period == 0 ? 1 : sample_period),
+    mode_counts(100 * MODE_COMBINATIONS, 0), instructions(0), block_start(0),
+    in_block(false), block_counted(false), sampling(false), sample_start(0), blocks_until_sample(0),
+    current_position(0), current_instruction(0) {}
+
+/**
+ * Called when run_program starts or resumes, the time spent outside of the
+ * program must not count towards the block that was interrupted
+ */
+void Profiler::resume(void) {
+    in_block = false;
+    sampling = false;
+}
+
+/**
+ * Note an instruction about to be executed, starting a new block if the
+ * previous instruction ended one. Nothing is counted until it retires, an
+ * instruction which stops the program (halt, input on empty input) never
+ * does
+ *
+ * @param position position of instruction
+ * @param instruction raw instruction value
+ */
+void Profiler::begin_instruction(long position, long instruction) {
+    if(!in_block) {
+        in_block = true;
+        block_start = position;
+        block_counted = false;
+
+        // only time one in every sample_period blocks so the counter read
+        // stays out of the common path
+        if(blocks_until_sample == 0) {
+            blocks_until_sample = sample_period;
+            sampling = true;
+            sample_start = read_cycle_counter();
+        }
+        blocks_until_sample--;
+    }
+
+    current_position = position;
+    current_instruction = instruction;
+}
+
+/**
+ * Count the instruction begun last as retired, jumps end the current block
+ */
+void Profiler::end_instruction(void) {
+    long position = current_position;
+
+    if(!block_counted) {
+        block_counted = true;
+        blocks[block_start].executions++;
+    }
+
+    if(position >= (long)position_counts.size()) {
+        position_counts.resize(position + 1, 0);
+        block_of_position.resize(position + 1, 0);
+        opcode_of_position.resize(position + 1, 0);
+    }
+
+    unsigned int opcode = (current_instruction >= 0) ? current_instruction % 100 : 0;
+
+    position_counts[position]++;
+    block_of_position[position] = block_start;
+    mode_counts[get_mode_index(current_instruction)]++;
+    opcode_of_position[position] = opcode;
+    instructions++;
+
+    if(opcode == 5 || opcode == 6) close_block();
+}
+
+/**
+ * End the current block, adding its cycle sample if it was being timed
+ */
+void Profiler::close_block(void) {
+    if(sampling) {
+        BlockProfile& block = blocks[block_start];
+        block.samples++;
+        block.sampled_cycles += read_cycle_counter() - sample_start;
+        sampling = false;
+    }
+    in_block = false;
+}
+
+/**
+ * Print the hottest positions, opcode/mode combinations and blocks sorted
+ * from most to least expensive
+ *
+ * @param out stream to write to
+ * @param top how many entries to show for each table
+ */
+void Profiler::print_report(std::ostream& out, size_t top) const {
+    char buffer[128];
+
+    out << "INSTRUCTIONS EXECUTED : " << instructions << std::endl;
+
+    std::vector<std::pair<unsigned long, long>> positions;
+    for(size_t i = 0; i < position_counts.size(); i++) {
+        if(position_counts[i] != 0) positions.push_back({position_counts[i], i});
+    }
+    std::sort(positions.rbegin(), positions.rend());
+
+    out << std::endl << "HOT POSITIONS" << std::endl;
+    for(size_t i = 0; i < positions.size() && i < top; i++) {
+        snprintf(buffer, sizeof(buffer), "%8ld %14lu %6.2f%%",
+            positions[i].second, positions[i].first, 100.0 * positions[i].first / instructions);
+        out << buffer << std::endl;
+    }
+
+    std::vector<std::pair<unsigned long, size_t>> modes;
+    for(size_t i = 0; i < mode_counts.size(); i++) {
+        if(mode_counts[i] != 0) modes.push_back({mode_counts[i], i});
+    }
+    std::sort(modes.rbegin(), modes.rend());
+
+    out << std::endl << "HOT OPCODES (MODES)" << std::endl;
+    for(size_t i = 0; i < modes.size() && i < top; i++) {
+        size_t opcode = modes[i].second / MODE_COMBINATIONS;
+        size_t combination = modes[i].second % MODE_COMBINATIONS;
+        // modes are stored first operand first, print them in instruction order
+        snprintf(buffer, sizeof(buffer), "%-12s %zu%zu%zu %14lu %6.2f%%",
+            get_opcode_name(opcode), combination % 4, (combination / 4) % 4, combination / 16,
+            modes[i].first, 100.0 * modes[i].first / instructions);
+        out << buffer << std::endl;
+    }
+
+    std::vector<std::pair<double, long>> hot_blocks;
+    double total_cycles = 0;
+    for(auto& block : blocks) {
+        hot_blocks.push_back({block.second.estimated_cycles(), block.first});
+        total_cycles += block.second.estimated_cycles();
+    }
+    std::sort(hot_blocks.rbegin(), hot_blocks.rend());
+
+    out << std::endl << "HOT BLOCKS (ESTIMATED CYCLES, 1 IN " << sample_period << " SAMPLED)" << std::endl;
+    for(size_t i = 0; i < hot_blocks.size() && i < top; i++) {
+        const BlockProfile& block = blocks.at(hot_blocks[i].second);
+        snprintf(buffer, sizeof(buffer), "%8ld %14lu %16.0f %6.2f%%",
+            hot_blocks[i].second, block.executions, hot_blocks[i].first,
+            total_cycles > 0 ? 100.0 * hot_blocks[i].first / total_cycles : 0.0);
+        out << buffer << std::endl;
+    }
+}
+
+/**
+ * Write execution counts in the folded stack format used by flamegraph.pl,
+ * each instruction is nested under the block it was last executed in
+ *
+ * @param out stream to write to
+ */
+void Profiler::write_folded(std::ostream& out) const {
+    for(size_t i = 0; i < position_counts.size(); i++) {
+        if(position_counts[i] == 0) continue;
+
+        out << "intcode;block_" << block_of_position[i] << ";"
+            << get_opcode_name(opcode_of_position[i]) << "@" << i << " "
+            << position_counts[i] << std::endl;
+    }
+}
+
+}
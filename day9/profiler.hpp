@@ -0,0 +1,81 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+namespace intcode {
+
+    /**
+     * Execution counts and sampled cycles for a single basic block, a block
+     * begins at the instruction after a jump (or where execution resumed) and
+     * ends at the next jump
+     */
+    class BlockProfile {
+    public:
+        unsigned long executions;
+        unsigned long samples;
+        unsigned long long sampled_cycles;
+
+        BlockProfile() : executions(0), samples(0), sampled_cycles(0) {}
+
+        /**
+         * Estimated total cycles spent in the block, the average cost of a
+         * sampled execution multiplied out over every execution
+         *
+         * @returns estimated cycles
+         */
+        double estimated_cycles(void) const {
+            if(samples == 0) return 0;
+            return (double)sampled_cycles / samples * executions;
+        }
+    };
+
+    /**
+     * Low overhead instruction level profiler for run_program, counts every
+     * retired instruction by position and by opcode/mode combination and times one in
+     * every sample_period basic block executions with the cycle counter
+     */
+    class Profiler {
+    public:
+        // opcodes are two digits and each of the three modes is clamped to 0-3
+        static const int MODE_COMBINATIONS = 64;
+
+        unsigned int sample_period;
+        std::vector<unsigned long> position_counts;
+        std::vector<unsigned long> mode_counts;
+        std::unordered_map<long, BlockProfile> blocks;
+        unsigned long instructions;
+
+        Profiler(unsigned int sample_period = 64);
+
+        void resume(void);
+        void begin_instruction(long position, long instruction);
+        void end_instruction(void);
+
+        void print_report(std::ostream& out, size_t top = 20) const;
+        void write_folded(std::ostream& out) const;
+
+    private:
+        long block_start;
+        bool in_block;
+        // if the current block's execution was counted, done once its first
+        // instruction retires
+        bool block_counted;
+        bool sampling;
+        unsigned long long sample_start;
+        unsigned long blocks_until_sample;
+        long current_position;
+        long current_instruction;
+        std::vector<long> block_of_position;
+        std::vector<unsigned char> opcode_of_position;
+
+        void close_block(void);
+    };
+
+    unsigned long long read_cycle_counter(void);
+
+}
+
+#endif // !PROFILER_HPP
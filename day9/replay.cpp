@@ -0,0 +1,224 @@
+#include <algorithm>
+
+#include "replay.hpp"
+
+namespace intcode {
+
+Recorder::Recorder(Engine& engine, unsigned long interval, size_t max_snapshots) :
+    engine(engine), interval(interval == 0 ? 1 : interval),
+    max_snapshots(std::max((size_t)2, max_snapshots)), inputs_consumed(0) {
+
+    // fused entries would make a single step cover several instructions
+    engine.optimize = false;
+    engine.cache.clear();
+
+    take_snapshot();
+}
+
+/**
+ * Execute a single instruction, logging any input it reads and taking a
+ * snapshot first if enough steps have passed since the last one
+ *
+ * @returns PROGRAM_RUNNING if execution can continue, otherwise the reason
+ * execution stopped
+ */
+unsigned int Recorder::step(void) {
+    if(engine.steps >= snapshots.back().steps + interval) take_snapshot();
+
+    size_t queued = engine.input.size();
+    long next_input = queued ? engine.input.front() : 0;
+
+    unsigned int reason = engine.step();
+
+    if(engine.input.size() < queued) {
+        // when replaying over already logged steps the input came from the log
+        if(inputs_consumed == input_log.size()) input_log.push_back(next_input);
+        inputs_consumed++;
+    }
+
+    return reason;
+}
+
+/**
+ * Run until the program stops
+ *
+ * @returns reason execution stopped
+ */
+unsigned int Recorder::run(void) {
+    unsigned int reason;
+    while((reason = step()) == PROGRAM_RUNNING);
+
+    return reason;
+}
+
+/**
+ * Run forward until the given amount of steps have been executed in total
+ *
+ * @param steps step count to stop at
+ * @returns PROGRAM_RUNNING if the step count was reached, otherwise the reason
+ * execution stopped early
+ */
+unsigned int Recorder::run_to(unsigned long steps) {
+    while(engine.steps < steps) {
+        unsigned int reason = step();
+        if(reason != PROGRAM_RUNNING) return reason;
+    }
+
+    return PROGRAM_RUNNING;
+}
+
+/**
+ * Put the machine into the exact state it was in after the given amount of
+ * steps, earlier steps are reached from the closest snapshot before them
+ *
+ * @param steps step count to move to
+ * @returns true if the step count was reached
+ */
+bool Recorder::seek(unsigned long steps) {
+    if(steps < engine.steps) restore(snapshots[find_snapshot(steps)]);
+
+    return run_to(steps) == PROGRAM_RUNNING;
+}
+
+/**
+ * Undo the given amount of steps
+ *
+ * @param count steps to go back
+ * @returns false if there are not that many steps to go back
+ */
+bool Recorder::step_back(unsigned long count) {
+    if(count > engine.steps) return false;
+
+    return seek(engine.steps - count);
+}
+
+/**
+ * Go back to the most recent earlier point where the next instruction to
+ * execute was at the given position, only replays one snapshot interval at a
+ * time going backwards until a match is found
+ *
+ * @param position instruction position to stop at
+ * @returns true if found, otherwise the machine is left where it was
+ */
+bool Recorder::run_back_to(long position) {
+    unsigned long current = engine.steps;
+    if(current == 0) return false;
+
+    unsigned long end = current;
+    for(size_t i = find_snapshot(current - 1) + 1; i-- > 0;) {
+        restore(snapshots[i]);
+        unsigned long start = engine.steps;
+
+        bool found = false;
+        unsigned long found_steps = 0;
+        while(engine.steps < end) {
+            if(engine.position == position) {
+                found = true;
+                found_steps = engine.steps;
+            }
+            if(step() != PROGRAM_RUNNING) break;
+        }
+
+        if(found) return seek(found_steps);
+
+        end = start;
+    }
+
+    seek(current);
+
+    return false;
+}
+
+/**
+ * Capture the current machine state, pages equal to the previous snapshot's
+ * are shared rather than copied
+ */
+void Recorder::take_snapshot(void) {
+    Snapshot snapshot;
+    snapshot.steps = engine.steps;
+    snapshot.position = engine.position;
+    snapshot.relative_base = engine.relative_base;
+    snapshot.tape_size = engine.tape.size();
+    snapshot.inputs_consumed = inputs_consumed;
+    snapshot.outputs_produced = engine.output.size();
+
+    const Snapshot* previous = snapshots.empty() ? nullptr : &snapshots.back();
+
+    for(size_t start = 0; start < snapshot.tape_size; start += SNAPSHOT_PAGE_SIZE) {
+        size_t end = std::min(start + SNAPSHOT_PAGE_SIZE, snapshot.tape_size);
+        size_t page = start / SNAPSHOT_PAGE_SIZE;
+
+        if(previous != nullptr && page < previous->pages.size()) {
+            const std::vector<long>& old_page = *previous->pages[page];
+            if(old_page.size() == end - start &&
+                std::equal(old_page.begin(), old_page.end(), engine.tape.begin() + start)) {
+
+                snapshot.pages.push_back(previous->pages[page]);
+                continue;
+            }
+        }
+
+        snapshot.pages.push_back(std::make_shared<const std::vector<long>>(
+            engine.tape.begin() + start, engine.tape.begin() + end));
+    }
+
+    snapshots.push_back(snapshot);
+
+    if(snapshots.size() > max_snapshots) thin_snapshots();
+}
+
+/**
+ * Put the engine back into a snapshot's state, inputs read after the
+ * snapshot are queued again from the log ahead of any not yet read input
+ *
+ * @param snapshot snapshot to restore
+ */
+void Recorder::restore(const Snapshot& snapshot) {
+    engine.tape.resize(snapshot.tape_size);
+    for(size_t page = 0; page < snapshot.pages.size(); page++) {
+        std::copy(snapshot.pages[page]->begin(), snapshot.pages[page]->end(),
+            engine.tape.begin() + page * SNAPSHOT_PAGE_SIZE);
+    }
+
+    engine.position = snapshot.position;
+    engine.relative_base = snapshot.relative_base;
+    engine.steps = snapshot.steps;
+    engine.output.resize(snapshot.outputs_produced);
+    engine.cache.clear();
+
+    // the queue holds the logged inputs not yet read again followed by fresh
+    // input which was never read at all
+    size_t requeued = input_log.size() - inputs_consumed;
+    std::deque<long> fresh(engine.input.begin() + std::min(requeued, engine.input.size()), engine.input.end());
+
+    engine.input.assign(input_log.begin() + snapshot.inputs_consumed, input_log.end());
+    engine.input.insert(engine.input.end(), fresh.begin(), fresh.end());
+    inputs_consumed = snapshot.inputs_consumed;
+}
+
+/**
+ * Find the latest snapshot taken at or before the given step count
+ *
+ * @param steps step count
+ * @returns snapshot index
+ */
+size_t Recorder::find_snapshot(unsigned long steps) const {
+    auto after = std::upper_bound(snapshots.begin(), snapshots.end(), steps,
+        [](unsigned long value, const Snapshot& snapshot) { return value < snapshot.steps; });
+
+    return (after == snapshots.begin()) ? 0 : (after - snapshots.begin()) - 1;
+}
+
+/**
+ * Drop every other snapshot and double the interval, keeps memory bounded on
+ * long runs at the cost of longer replays for old steps
+ */
+void Recorder::thin_snapshots(void) {
+    std::vector<Snapshot> kept;
+    for(size_t i = 0; i < snapshots.size(); i += 2) kept.push_back(snapshots[i]);
+
+    snapshots = kept;
+    interval *= 2;
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <memory>
+#include <vector>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // tape cells per snapshot page
+    const size_t SNAPSHOT_PAGE_SIZE = 1024;
+
+    typedef std::shared_ptr<const std::vector<long>> SnapshotPage;
+
+    /**
+     * Full machine state at a given step, tape pages which did not change
+     * since the previous snapshot are shared with it instead of copied
+     */
+    class Snapshot {
+    public:
+        unsigned long steps;
+        long position;
+        long relative_base;
+        size_t tape_size;
+        std::vector<SnapshotPage> pages;
+        // amount of logged inputs consumed and outputs produced before the
+        // snapshot was taken
+        size_t inputs_consumed;
+        size_t outputs_produced;
+    };
+
+    /**
+     * Drives an engine while taking periodic snapshots and logging every input
+     * read, any earlier step can then be reached again by restoring the
+     * closest snapshot before it and replaying forward from there
+     *
+     * The engine is switched to unfused decoding so that every step is a
+     * single instruction
+     */
+    class Recorder {
+    public:
+        Engine& engine;
+        // steps between snapshots, doubled whenever old snapshots are thinned
+        unsigned long interval;
+        size_t max_snapshots;
+        std::vector<Snapshot> snapshots;
+        // every input value the program has read, in order
+        std::vector<long> input_log;
+        size_t inputs_consumed;
+
+        Recorder(Engine& engine, unsigned long interval = 1 << 16, size_t max_snapshots = 256);
+
+        unsigned int step(void);
+        unsigned int run(void);
+        unsigned int run_to(unsigned long steps);
+
+        bool seek(unsigned long steps);
+        bool step_back(unsigned long count = 1);
+        bool run_back_to(long position);
+
+        void take_snapshot(void);
+        void restore(const Snapshot& snapshot);
+
+    private:
+        size_t find_snapshot(unsigned long steps) const;
+        void thin_snapshots(void);
+    };
+
+}
+
+#endif // !REPLAY_HPP
@@ -0,0 +1,133 @@
+#include <algorithm>
+
+#include "specialize.hpp"
+
+namespace intcode {
+
+Specializer::Specializer(const std::vector<long>& program) : program(program) {}
+
+void Specializer::stored(long location, long /*old_value*/) {
+    dynamic.erase(location);
+}
+
+/**
+ * Returns if the instruction at the current position, or any operand it
+ * reads, is a dynamic cell
+ *
+ * @param engine engine about to step
+ * @returns true if the instruction can not be folded
+ */
+bool Specializer::reads_dynamic(const Engine& engine) const {
+    long position = engine.position;
+    if(position < 0 || position >= (long)engine.tape.size()) return false;
+    if(dynamic.count(position)) return true;
+
+    DecodedInstruction instruction = decode_instruction(engine.tape, position);
+    int operands = get_operand_count(instruction.opcode);
+    for(long i = 1; i <= operands; i++) {
+        if(dynamic.count(position + i)) return true;
+    }
+
+    // input has no read operand, everything else reads at most two
+    int reads = (instruction.opcode == OP_INPUT) ? 0 : std::min(operands, 2);
+    for(int i = 0; i < reads; i++) {
+        if(instruction.modes[i] == MODE_IMMEDIATE) continue;
+        if(dynamic.count(engine.address(instruction.modes[i], instruction.args[i]))) return true;
+    }
+
+    return false;
+}
+
+/**
+ * Fold the program on the given prefix
+ *
+ * @param inputs inputs known ahead of time, in order
+ * @param cells cells poked into the program before it runs
+ * @param dynamic cells only known at run time
+ * @param max_steps instructions to fold before giving up
+ * @returns residual state
+ */
+Specialization Specializer::run(const std::vector<long>& inputs,
+    const std::vector<std::pair<long, long>>& cells, const std::vector<long>& dynamic,
+    unsigned long max_steps) {
+
+    Specialization result;
+    result.tape = program;
+    for(auto& cell : cells) {
+        if(cell.first < 0) {
+            throw std::runtime_error("Attempted write to out of bounds address " + std::to_string(cell.first));
+        }
+        if(cell.first >= (long)result.tape.size()) result.tape.resize(cell.first + 1, 0);
+        result.tape[cell.first] = cell.second;
+    }
+
+    Specializer::dynamic.clear();
+    Specializer::dynamic.insert(dynamic.begin(), dynamic.end());
+
+    // one instruction per step so folding stops right before the first
+    // dynamic read
+    Engine engine(result.tape, false);
+    engine.watcher = this;
+    engine.push_input(inputs);
+
+    unsigned int reason = PROGRAM_RUNNING;
+    while(engine.steps < max_steps && !reads_dynamic(engine)) {
+        if((reason = engine.step()) != PROGRAM_RUNNING) break;
+    }
+
+    result.position = engine.position;
+    result.relative_base = engine.relative_base;
+    result.output = engine.output;
+    result.steps = engine.steps;
+    result.reason = reason;
+    result.dynamic.assign(Specializer::dynamic.begin(), Specializer::dynamic.end());
+    std::sort(result.dynamic.begin(), result.dynamic.end());
+
+    return result;
+}
+
+/**
+ * Specialize a program for known leading inputs and cell values
+ *
+ * @param program program tape
+ * @param inputs inputs known ahead of time, in order
+ * @param cells cells poked into the program before it runs
+ * @param dynamic cells only known at run time
+ * @returns residual state
+ */
+Specialization specialize(const std::vector<long>& program, const std::vector<long>& inputs,
+    const std::vector<std::pair<long, long>>& cells, const std::vector<long>& dynamic) {
+
+    return Specializer(program).run(inputs, cells, dynamic);
+}
+
+/**
+ * Put an engine into the residual state, its input queue is left alone
+ *
+ * @param engine engine to restore into
+ */
+void Specialization::restore(Engine& engine) const {
+    engine.tape = tape;
+    engine.position = position;
+    engine.relative_base = relative_base;
+    engine.output = output;
+    engine.steps = steps;
+    engine.cache.clear();
+}
+
+void Specialization::print(std::ostream& out) const {
+    out << "FOLDED STEPS " << steps << std::endl;
+    out << "RESUME AT " << position << " BASE " << relative_base << std::endl;
+    out << "FOLDED OUTPUT " << output.size() << std::endl;
+
+    out << "STOPPED ON ";
+    switch(reason) {
+        case INPUT_EMPTY: out << "INPUT"; break;
+        case PROGRAM_RUNNING: out << "DYNAMIC READ"; break;
+        case PROGRAM_FINISH: out << "FINISH"; break;
+        default: out << "STATE " << reason; break;
+    }
+    out << std::endl;
+}
+
+}
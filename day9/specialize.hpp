@@ -0,0 +1,70 @@
+#ifndef SPECIALIZE_HPP
+#define SPECIALIZE_HPP
+
+#include <vector>
+#include <unordered_set>
+#include <ostream>
+
+#include "engine.hpp"
+
+namespace intcode {
+
+    // instructions folded before a program that never reaches anything
+    // dynamic is given up on
+    const unsigned long MAX_SPECIALIZE_STEPS = 1UL << 32;
+
+    /**
+     * Residual machine state left after running everything that depends only
+     * on the known inputs and cells, every run with the same prefix can start
+     * from here instead of from the beginning
+     */
+    class Specialization {
+    public:
+        std::vector<long> tape;
+        long position;
+        long relative_base;
+        // output produced while folding
+        std::vector<long> output;
+        // instructions folded
+        unsigned long steps;
+        // INPUT_EMPTY when the known inputs ran out, PROGRAM_RUNNING when the
+        // next instruction reads a dynamic cell or the step limit was hit,
+        // otherwise the reason the program stopped on its own
+        unsigned int reason;
+        // dynamic cells the folded prefix never overwrote
+        std::vector<long> dynamic;
+
+        Specialization() : position(0), relative_base(0), steps(0), reason(PROGRAM_BEGIN) {}
+
+        void restore(Engine& engine) const;
+        void print(std::ostream& out) const;
+    };
+
+    /**
+     * Executes a program for as long as every instruction only reads cells
+     * whose values are known, a dynamic cell becomes known once it is written
+     */
+    class Specializer : public StoreWatcher {
+    public:
+        Specializer(const std::vector<long>& program);
+
+        Specialization run(const std::vector<long>& inputs,
+            const std::vector<std::pair<long, long>>& cells = {},
+            const std::vector<long>& dynamic = {},
+            unsigned long max_steps = MAX_SPECIALIZE_STEPS);
+
+        void stored(long location, long old_value) override;
+
+    private:
+        const std::vector<long>& program;
+        std::unordered_set<long> dynamic;
+
+        bool reads_dynamic(const Engine& engine) const;
+    };
+
+    Specialization specialize(const std::vector<long>& program, const std::vector<long>& inputs,
+        const std::vector<std::pair<long, long>>& cells = {}, const std::vector<long>& dynamic = {});
+
+}
+
+#endif // !SPECIALIZE_HPP
@@ -0,0 +1,136 @@
+#include <cstdio>
+
+#include "tiering.hpp"
+#include "engine.hpp"
+#include "ir.hpp"
+
+namespace intcode {
+
+static const char* tier_names[TIER_COUNT] = { "BASELINE", "ENGINE", "IR" };
+
+Tiering::Tiering(unsigned long engine_threshold, unsigned long ir_threshold, std::ostream* log) :
+    engine_threshold(engine_threshold), ir_threshold(ir_threshold), log(log),
+    retired{0}, promotions(0), deopts(0) {}
+
+/**
+ * Count an entry to the block starting at the given position in run_program
+ *
+ * @param position first instruction of the block
+ * @returns true if the machine should move to the engine tier here
+ */
+bool Tiering::enter_block(long position) {
+    if(position >= (long)baseline_counts.size()) baseline_counts.resize(position + 1, 0);
+
+    if(++baseline_counts[position] < engine_threshold) return false;
+
+    log_event("PROMOTE", position, TIER_BASELINE, TIER_ENGINE);
+    promotions++;
+
+    return true;
+}
+
+/**
+ * Continue a run_program call on the engine, taking over the machine state
+ * at a block boundary. Hot blocks are handed on to the IR tier, any stores
+ * into code throw away compiled blocks and are logged as deopts
+ *
+ * @param tape program tape, run in place
+ * @param position block to continue at
+ * @param relative_base current relative base
+ * @param input unread input, whatever is left unread is put back
+ * @param output output so far, appended to
+ * @returns run state the same way run_program returns it
+ */
+RunState Tiering::run_from(std::vector<long>& tape, long position, long relative_base,
+    NumberStream& input, std::vector<long>& output) {
+
+    Engine engine(tape);
+    engine.position = position;
+    engine.relative_base = relative_base;
+    // the stream is read from the back
+    engine.input.assign(input.contents.rbegin(), input.contents.rend());
+    engine.output.swap(output);
+
+    IRRunner runner(engine);
+
+    unsigned int reason = PROGRAM_RUNNING;
+    bool block_start = true;
+
+    while(reason == PROGRAM_RUNNING) {
+        long current = engine.position;
+
+        if(block_start && current >= 0) {
+            if(current >= (long)engine_counts.size()) engine_counts.resize(current + 1, 0);
+            unsigned long count = ++engine_counts[current];
+
+            if(count == ir_threshold) {
+                log_event("PROMOTE", current, TIER_ENGINE, TIER_IR);
+                promotions++;
+            }
+
+            if(count >= ir_threshold) {
+                unsigned long block_deopts = runner.stats.deopts;
+                unsigned long steps = engine.steps;
+
+                if(runner.run_block()) {
+                    retired[TIER_IR] += engine.steps - steps;
+                    if(runner.stats.deopts != block_deopts) {
+                        log_event("DEOPT", current, TIER_IR, TIER_ENGINE);
+                        deopts++;
+                    }
+                    continue;
+                }
+            }
+        }
+
+        unsigned long steps = engine.steps;
+        unsigned long engine_deopts = engine.stats.deopts;
+
+        reason = runner.interpret();
+        retired[TIER_ENGINE] += engine.steps - steps;
+
+        if(engine.stats.deopts != engine_deopts) {
+            log_event("DEOPT", current, TIER_ENGINE, TIER_ENGINE);
+            deopts++;
+        }
+
+        // anything other than falling through to the next entry ends the block
+        const DecodeCache& cache = engine.cache;
+        unsigned int opcode = cache.has_entry(current) ? cache.entries[current].opcode : 0;
+        block_start = opcode == 0 || opcode == OP_JUMP_TRUE || opcode == OP_JUMP_FALSE || opcode == SUPER_CMP_JUMP;
+    }
+
+    input.contents.assign(engine.input.rbegin(), engine.input.rend());
+    output.swap(engine.output);
+
+    long stopped_at = (reason == OUT_OF_INSTRUCTIONS) ? (long)tape.size() : engine.position;
+
+    return RunState(stopped_at, output, reason);
+}
+
+void Tiering::log_event(const char* event, long position, int from, int to) {
+    if(log == nullptr) return;
+
+    *log << "TIER " << event << " " << position << " " << tier_names[from] << " -> " << tier_names[to] << std::endl;
+}
+
+/**
+ * Print how many instructions each tier retired
+ *
+ * @param out stream to write to
+ */
+void Tiering::print(std::ostream& out) const {
+    char buffer[64];
+    unsigned long total = retired[TIER_BASELINE] + retired[TIER_ENGINE] + retired[TIER_IR];
+
+    for(int i = 0; i < TIER_COUNT; i++) {
+        snprintf(buffer, sizeof(buffer), "%-10s %14lu %6.2f%%",
+            tier_names[i], retired[i], total > 0 ? 100.0 * retired[i] / total : 0.0);
+        out << buffer << std::endl;
+    }
+
+    out << "PROMOTIONS " << promotions << std::endl;
+    out << "DEOPTS " << deopts << std::endl;
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef TIERING_HPP
+#define TIERING_HPP
+
+#include <vector>
+#include <ostream>
+
+#include "intcode.hpp"
+
+namespace intcode {
+
+    // execution tiers, from cheapest to start to fastest to run
+    enum {
+        TIER_BASELINE,
+        TIER_ENGINE,
+        TIER_IR,
+        TIER_COUNT
+    };
+
+    /**
+     * Promotes hot code out of run_program, counting entries to every basic
+     * block (the instruction after a jump or where execution resumed). The
+     * first block reaching engine_threshold entries moves the whole machine
+     * into the decode cache engine at that block boundary, from there blocks
+     * reaching ir_threshold entries are run as compiled IR blocks
+     */
+    class Tiering {
+    public:
+        unsigned long engine_threshold;
+        unsigned long ir_threshold;
+        // promotions and deopts are written here as they happen, may be null
+        std::ostream* log;
+
+        // original instructions retired in each tier
+        unsigned long retired[TIER_COUNT];
+        unsigned long promotions;
+        unsigned long deopts;
+
+        Tiering(unsigned long engine_threshold = 64, unsigned long ir_threshold = 256,
+            std::ostream* log = nullptr);
+
+        bool enter_block(long position);
+        void retire_baseline(void) { retired[TIER_BASELINE]++; }
+        RunState run_from(std::vector<long>& tape, long position, long relative_base,
+            NumberStream& input, std::vector<long>& output);
+
+        void print(std::ostream& out) const;
+
+    private:
+        std::vector<unsigned long> baseline_counts;
+        std::vector<unsigned long> engine_counts;
+
+        void log_event(const char* event, long position, int from, int to);
+    };
+
+}
+
+#endif // !TIERING_HPP
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.hpp"
+
+namespace intcode {
+
+/**
+ * Create (or truncate) a trace file large enough to hold capacity records and
+ * map it into memory
+ *
+ * @param file_location location of trace file
+ * @param capacity amount of records kept before the oldest are overwritten
+ */
+TraceRecorder::TraceRecorder(std::string file_location, uint64_t capacity) {
+    if(capacity == 0) capacity = 1;
+
+    descriptor = open(file_location.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(descriptor < 0) {
+        throw std::runtime_error("Unable to open trace file '" + file_location + "'");
+    }
+
+    mapped_size = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+    if(ftruncate(descriptor, mapped_size) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Unable to size trace file '" + file_location + "'");
+    }
+
+    void* memory = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if(memory == MAP_FAILED) {
+        close(descriptor);
+        throw std::runtime_error("Unable to map trace file '" + file_location + "'");
+    }
+
+    header = (TraceHeader*)memory;
+    records = (TraceRecord*)(header + 1);
+
+    memcpy(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header->record_size = sizeof(TraceRecord);
+    header->capacity = capacity;
+    header->written = 0;
+
+    memset(&pending, 0, sizeof(pending));
+}
+
+TraceRecorder::~TraceRecorder() {
+    munmap(header, mapped_size);
+    close(descriptor);
+}
+
+/**
+ * Start a record for the instruction about to execute, the written location
+ * is worked out before execution since the instruction may overwrite the
+ * operands it was derived from
+ *
+ * @param position position of instruction
+ * @param tape program tape
+ * @param relative_base current relative base
+ */
+void TraceRecorder::begin(long position, const std::vector<long>& tape, long relative_base) {
+    long size = tape.size();
+    long instruction = tape[position];
+
+    pending.position = position;
+    pending.instruction = instruction;
+    for(int i = 0; i < 3; i++) {
+        pending.operands[i] = (position + i + 1 < size) ? tape[position + i + 1] : 0;
+    }
+
+    // find which operand, if any, is written to
+    int opcode = instruction % 100;
+    int written_operand = -1;
+    if(opcode == 1 || opcode == 2 || opcode == 7 || opcode == 8) written_operand = 2;
+    else if(opcode == 3) written_operand = 0;
+
+    pending.write_location = -1;
+    if(written_operand >= 0) {
+        long mode = instruction / 100;
+        for(int i = 0; i < written_operand; i++) mode /= 10;
+
+        pending.write_location = pending.operands[written_operand];
+        if(mode % 10 == 2) pending.write_location += relative_base;
+    }
+}
+
+/**
+ * Finish the pending record with the written value and append it to the ring
+ *
+ * @param tape program tape after the instruction executed
+ */
+void TraceRecorder::end(const std::vector<long>& tape) {
+    long location = pending.write_location;
+    pending.write_value = (location >= 0 && location < (long)tape.size()) ? tape[location] : 0;
+    pending.sequence = header->written;
+
+    records[header->written % header->capacity] = pending;
+    header->written++;
+}
+
+/**
+ * Map an existing trace file for reading
+ *
+ * @param file_location location of trace file
+ */
+TraceReader::TraceReader(std::string file_location) {
+    descriptor = open(file_location.c_str(), O_RDONLY);
+    if(descriptor < 0) {
+        throw std::runtime_error("Unable to open trace file '" + file_location + "'");
+    }
+
+    struct stat info;
+    fstat(descriptor, &info);
+    mapped_size = info.st_size;
+
+    if(mapped_size < sizeof(TraceHeader)) {
+        close(descriptor);
+        throw std::runtime_error("Trace file '" + file_location + "' is too small");
+    }
+
+    void* memory = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if(memory == MAP_FAILED) {
+        close(descriptor);
+        throw std::runtime_error("Unable to map trace file '" + file_location + "'");
+    }
+
+    header = (const TraceHeader*)memory;
+    records = (const TraceRecord*)(header + 1);
+
+    if(memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        header->record_size != sizeof(TraceRecord) ||
+        mapped_size < sizeof(TraceHeader) + header->capacity * sizeof(TraceRecord)) {
+
+        munmap(memory, mapped_size);
+        close(descriptor);
+        throw std::runtime_error("'" + file_location + "' is not a valid trace file");
+    }
+}
+
+TraceReader::~TraceReader() {
+    munmap((void*)header, mapped_size);
+    close(descriptor);
+}
+
+/**
+ * Amount of records still held in the ring
+ *
+ * @returns record count
+ */
+uint64_t TraceReader::size(void) const {
+    return std::min(header->written, header->capacity);
+}
+
+/**
+ * Get a record by age, 0 being the oldest record still held
+ *
+ * @param index record index
+ * @returns record
+ */
+const TraceRecord& TraceReader::at(uint64_t index) const {
+    uint64_t first = (header->written > header->capacity) ? header->written - header->capacity : 0;
+    return records[(first + index) % header->capacity];
+}
+
+}
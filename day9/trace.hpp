@@ -0,0 +1,91 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace intcode {
+
+    const char TRACE_MAGIC[8] = { 'I', 'C', 'T', 'R', 'A', 'C', 'E', '1' };
+
+    /**
+     * A single executed instruction, fixed size so records can be written
+     * straight into the mapped file and read back without parsing
+     */
+    class TraceRecord {
+    public:
+        uint64_t sequence;
+        int64_t position;
+        // raw instruction value, opcode and modes
+        int64_t instruction;
+        // raw operand values following the instruction
+        int64_t operands[3];
+        // -1 if the instruction does not write to the tape
+        int64_t write_location;
+        int64_t write_value;
+    };
+
+    /**
+     * Placed at the start of every trace file, records follow directly after
+     * and wrap around once capacity records have been written
+     */
+    class TraceHeader {
+    public:
+        char magic[8];
+        uint64_t record_size;
+        uint64_t capacity;
+        // total records ever written, the oldest record still present is at
+        // index written % capacity once the ring has wrapped
+        uint64_t written;
+    };
+
+    /**
+     * Appends trace records to a memory mapped ring file, a record costs a
+     * copy into mapped memory and nothing is formatted while the program runs
+     */
+    class TraceRecorder {
+    public:
+        TraceRecorder(std::string file_location, uint64_t capacity = 1 << 20);
+        ~TraceRecorder();
+
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+        void begin(long position, const std::vector<long>& tape, long relative_base);
+        void end(const std::vector<long>& tape);
+
+        uint64_t get_written(void) const { return header->written; }
+
+    private:
+        int descriptor;
+        size_t mapped_size;
+        TraceHeader* header;
+        TraceRecord* records;
+        TraceRecord pending;
+    };
+
+    /**
+     * Read only view of a trace file, records are returned oldest first
+     */
+    class TraceReader {
+    public:
+        TraceReader(std::string file_location);
+        ~TraceReader();
+
+        TraceReader(const TraceReader&) = delete;
+        TraceReader& operator=(const TraceReader&) = delete;
+
+        uint64_t size(void) const;
+        const TraceRecord& at(uint64_t index) const;
+
+    private:
+        int descriptor;
+        size_t mapped_size;
+        const TraceHeader* header;
+        const TraceRecord* records;
+    };
+
+}
+
+#endif // !TRACE_HPP
@@ -0,0 +1,175 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "intcode.hpp"
+#include "trace.hpp"
+
+/**
+ * Filters for the dump command, negative values are unset
+ */
+class TraceFilter {
+public:
+    long position;
+    long opcode;
+    long location;
+    uint64_t from;
+    uint64_t limit;
+
+    TraceFilter() : position(-1), opcode(-1), location(-1), from(0), limit(UINT64_MAX) {}
+
+    /**
+     * Returns if the record passes every set filter
+     *
+     * @param record trace record
+     * @returns true if record should be shown
+     */
+    bool matches(const intcode::TraceRecord& record) const {
+        if(record.sequence < from) return false;
+        if(position >= 0 && record.position != position) return false;
+        if(opcode >= 0 && record.instruction % 100 != opcode) return false;
+        if(location >= 0 && record.write_location != location) return false;
+        return true;
+    }
+};
+
+/**
+ * Get an opcode number from its name or number
+ *
+ * @param name opcode name (as given by get_opcode_name) or number
+ * @returns opcode, -1 if unknown
+ */
+long parse_opcode(const char* name) {
+    for(int i = 0; i < 100; i++) {
+        if(strcmp(intcode::get_opcode_name(i), name) == 0) return i;
+    }
+    if(name[0] < '0' || name[0] > '9') return -1;
+    long opcode = std::stol(name);
+    return (opcode < 100) ? opcode : -1;
+}
+
+/**
+ * Print a single record in a readable form
+ *
+ * @param record trace record
+ */
+void print_record(const intcode::TraceRecord& record) {
+    long instruction = record.instruction;
+    unsigned int opcode = (instruction >= 0) ? instruction % 100 : 0;
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "%12lu %8ld  %-11s %03ld  %ld, %ld, %ld",
+        (unsigned long)record.sequence, (long)record.position, intcode::get_opcode_name(opcode),
+        (long)(instruction / 100), (long)record.operands[0], (long)record.operands[1],
+        (long)record.operands[2]);
+    std::cout << buffer;
+
+    if(record.write_location >= 0) {
+        std::cout << "  [" << record.write_location << "] = " << record.write_value;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Returns if two records describe the same execution step
+ */
+bool same_record(const intcode::TraceRecord& a, const intcode::TraceRecord& b) {
+    return a.position == b.position && a.instruction == b.instruction &&
+        a.operands[0] == b.operands[0] && a.operands[1] == b.operands[1] &&
+        a.operands[2] == b.operands[2] && a.write_location == b.write_location &&
+        a.write_value == b.write_value;
+}
+
+int do_dump(const std::string& file_location, const TraceFilter& filter) {
+    intcode::TraceReader reader(file_location);
+
+    uint64_t shown = 0;
+    for(uint64_t i = 0; i < reader.size() && shown < filter.limit; i++) {
+        const intcode::TraceRecord& record = reader.at(i);
+        if(!filter.matches(record)) continue;
+
+        print_record(record);
+        shown++;
+    }
+
+    return 0;
+}
+
+int do_diff(const std::string& location_a, const std::string& location_b, uint64_t context) {
+    intcode::TraceReader a(location_a);
+    intcode::TraceReader b(location_b);
+
+    uint64_t length = std::min(a.size(), b.size());
+    for(uint64_t i = 0; i < length; i++) {
+        if(same_record(a.at(i), b.at(i))) continue;
+
+        std::cout << "TRACES DIVERGE AT RECORD " << i << std::endl;
+
+        uint64_t start = (i > context) ? i - context : 0;
+        for(uint64_t j = start; j < i; j++) print_record(a.at(j));
+
+        std::cout << "< " << location_a << std::endl;
+        print_record(a.at(i));
+        std::cout << "> " << location_b << std::endl;
+        print_record(b.at(i));
+
+        return 1;
+    }
+
+    if(a.size() != b.size()) {
+        std::cout << "TRACES MATCH FOR " << length << " RECORDS, LENGTHS DIFFER ("
+            << a.size() << " VS " << b.size() << ")" << std::endl;
+        return 1;
+    }
+
+    std::cout << "TRACES MATCH (" << length << " RECORDS)" << std::endl;
+    return 0;
+}
+
+void print_usage(void) {
+    std::cout << "usage: intcode-trace dump <trace> [--pc N] [--op NAME] [--addr N] [--from SEQ] [--limit N]" << std::endl;
+    std::cout << "       intcode-trace diff <trace> <trace> [--context N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+
+    if(argc < 3) {
+        print_usage();
+        return -1;
+    }
+
+    std::string command = argv[1];
+
+    try {
+        if(command == "dump") {
+            TraceFilter filter;
+            for(int i = 3; i + 1 < argc; i += 2) {
+                if(strcmp(argv[i], "--pc") == 0) filter.position = std::stol(argv[i+1]);
+                else if(strcmp(argv[i], "--op") == 0) {
+                    filter.opcode = parse_opcode(argv[i+1]);
+                    if(filter.opcode < 0) {
+                        std::cout << "Unknown opcode '" << argv[i+1] << "'" << std::endl;
+                        return -1;
+                    }
+                }
+                else if(strcmp(argv[i], "--addr") == 0) filter.location = std::stol(argv[i+1]);
+                else if(strcmp(argv[i], "--from") == 0) filter.from = std::stoul(argv[i+1]);
+                else if(strcmp(argv[i], "--limit") == 0) filter.limit = std::stoul(argv[i+1]);
+            }
+            return do_dump(argv[2], filter);
+        }
+
+        if(command == "diff" && argc >= 4) {
+            uint64_t context = 8;
+            if(argc >= 6 && strcmp(argv[4], "--context") == 0) context = std::stoul(argv[5]);
+            return do_diff(argv[2], argv[3], context);
+        }
+    } catch(const std::exception& error) {
+        std::cout << error.what() << std::endl;
+        return -1;
+    }
+
+    print_usage();
+    return -1;
+}